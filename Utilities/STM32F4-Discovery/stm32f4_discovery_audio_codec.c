@@ -250,7 +250,6 @@ static void     Delay(__IO uint32_t nCount);
                    MAL (Media Access Layer) functions 
                                     ------------------------------------------*/
 /* Peripherals configuration functions */
-static void     Audio_MAL_Init(void);
 static void     Audio_MAL_DeInit(void);
 static void     Audio_MAL_PauseResume(uint32_t Cmd, uint32_t Addr);
 static void     Audio_MAL_Stop(void);
@@ -520,7 +519,7 @@ static void Audio_MAL_IRQHandler(void)
  #elif defined(AUDIO_MAL_MODE_CIRCULAR)
     /* Manage the remaining file size and new address offset: This function 
        should be coded by user (its prototype is already declared in stm32f4_discovery_audio_codec.h) */  
-    EVAL_AUDIO_TransferComplete_CallBack(pAddr, Size);    
+    EVAL_AUDIO_TransferComplete_CallBack((uint32_t)pAddr, Size);    
     
     /* Clear the Interrupt flag */
     DMA_ClearFlag(AUDIO_MAL_DMA_STREAM, AUDIO_MAL_DMA_FLAG_TC);
@@ -1316,7 +1315,7 @@ uint32_t Codec_TIMEOUT_UserCallback(void)
   * @param  None
   * @retval None
   */
-static void Audio_MAL_Init(void)  
+void Audio_MAL_Init(void)  
 { 
   
 #ifdef I2S_INTERRUPT  
@@ -0,0 +1,35 @@
+//*************************************
+//
+//  host stand-in for the device header
+//
+//	Only the Cortex-M4 DSP intrinsics ks_kernel.c uses, written
+//	in C with the instruction's exact arithmetic, so the packed
+//	kernel can be tested on a PC (see host/test_kernel.c).
+//
+//*************************************
+
+#include <stdint.h>
+
+#ifndef __STM32F4xx_H
+#define __STM32F4xx_H
+
+/*
+ * SMUAD: sum of the products of the signed low and high halfwords (wraps like the instruction)
+ */
+static inline uint32_t __SMUAD(uint32_t x, uint32_t y)
+{
+	int64_t sum = (int64_t)(int16_t)x*(int16_t)y + (int64_t)(int16_t)(x >> 16)*(int16_t)(y >> 16);
+
+	return (uint32_t)sum;
+}
+
+/*
+ * PKHBT: low halfword of x, high halfword of y shifted left
+ */
+static inline uint32_t __PKHBT(uint32_t x, uint32_t y, uint32_t shift)
+{
+	return (x & 0x0000FFFF) | ((y << shift) & 0xFFFF0000);
+}
+
+
+#endif /* __STM32F4xx_H */
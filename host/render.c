@@ -0,0 +1,264 @@
+//*************************************
+//
+//  host renderer for the synthesis core
+//
+//	Runs the synthesis core (synth.c, ks_kernel.c, notes.c) and the
+//	note scheduler (schedule.c, event.c) on a PC: queues a pluck
+//	sequence as timestamped events the way the beam interrupt does,
+//	writes the result to a 16-bit stereo WAV file and
+//	reports how many samples per second the core renders, so changes
+//	to the engine can be benchmarked and listened to off the board.
+//	The excitation noise comes from a fixed-seed generator, so the
+//	same sequence always renders the same file (usable as a golden
+//	file to compare against).
+//
+//	Build from the repository root:
+//	  gcc -O2 -std=gnu99 -Wall -Isrc -o render host/render.c src/synth.c src/ks_kernel.c src/notes.c src/schedule.c src/event.c
+//
+//	Usage:
+//	  render [-e] [-t tuning] [-s seconds] out.wav [time,string,fret[,volume[,velocity]] ...]
+//	    -e          electric mode
+//	    -t tuning   0 = standard, 1 = drop D, 2 = open G
+//	    -s seconds  length of the file (default: until the last note has finished)
+//	    time        pluck time in ms, string 1-6, fret 0-4, volume 0.0-10.0 (as the volume knob);
+//	                without a volume the fret changes on a ringing string instead (hammer-on/pull-off);
+//	    velocity    0.0-1.0 (default 1.0), scales the amplitude and darkens the pluck as a slow beam break does
+//	Each note starts on the exact frame of its pluck time (on the board every note is also
+//	SCHEDULE_LATENCY_FRAMES late; here that constant delay is left out).
+//	With no plucks given an open E major strum is rendered.
+//
+//*************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "synth.h"
+#include "notes.h"
+#include "event.h"
+#include "schedule.h"
+
+#define NOTE_DURATION	44100		// samples a note rings for (same as main.c)
+#define MAX_PLUCKS		256
+
+typedef struct
+{
+	uint32_t frame;			// pluck time in samples
+	uint8_t stringNo;		// 1-6
+	uint8_t fret;			// 0-4
+	float volume;			// < 0: fret change, no pluck
+	float velocity;
+} pluck;
+
+static pluck plucks[MAX_PLUCKS];
+static int16_t noiseBuffer[SYNTH_MAX_DELAY];
+static uint32_t noiseSeed = 1;
+
+// default sequence: E major strummed low to high, then the top string again
+static const char *defaultPlucks[] =
+{
+	"0,6,0,5", "30,5,2,5", "60,4,2,5", "90,3,1,5", "120,2,0,5", "150,1,0,5", "1000,1,0,8"
+};
+
+static void usage(void);
+static int parse_pluck(const char *arg, pluck *p);
+static const int16_t *next_noise(void);
+static void write_wav_header(FILE *file, uint32_t frames);
+static double seconds_now(void);
+
+int main(int argc, char *argv[])
+{
+	const char *outName = 0;
+	uint8_t tuning = TUNING_STANDARD;
+	uint8_t electric = 0;
+	float seconds = 0;
+	uint16_t nPlucks = 0;
+	uint16_t next = 0;
+	uint32_t totalFrames, frame = 0;
+	string_event event;
+	int16_t block[2*SYNTH_BLOCK_FRAMES];
+	double renderTime = 0, start;
+	FILE *file;
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-e") == 0)
+			electric = 1;
+		else if(strcmp(argv[i], "-t") == 0 && i+1 < argc)
+			tuning = (uint8_t)atoi(argv[++i]);
+		else if(strcmp(argv[i], "-s") == 0 && i+1 < argc)
+			seconds = (float)atof(argv[++i]);
+		else if(outName == 0)
+			outName = argv[i];
+		else if(nPlucks < MAX_PLUCKS && parse_pluck(argv[i], &plucks[nPlucks]) == 0)
+			nPlucks++;
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if(outName == 0 || tuning >= NOTE_TUNINGS)
+	{
+		usage();
+		return 1;
+	}
+
+	if(nPlucks == 0)
+	{
+		for(nPlucks = 0; nPlucks < sizeof(defaultPlucks)/sizeof(defaultPlucks[0]); nPlucks++)
+			parse_pluck(defaultPlucks[nPlucks], &plucks[nPlucks]);
+	}
+
+	// the sequence is played in time order
+	for(i = 1; i < nPlucks; i++)
+	{
+		pluck p = plucks[i];
+		int j = i;
+		while(j > 0 && plucks[j-1].frame > p.frame)
+		{
+			plucks[j] = plucks[j-1];
+			j--;
+		}
+		plucks[j] = p;
+	}
+
+	if(seconds > 0)
+		totalFrames = (uint32_t)(seconds*SYNTH_SAMPLE_RATE);
+	else
+		totalFrames = plucks[nPlucks-1].frame + NOTE_DURATION;
+
+	file = fopen(outName, "wb");
+	if(file == 0)
+	{
+		perror(outName);
+		return 1;
+	}
+	write_wav_header(file, totalFrames);
+
+	synth_set_electric(electric);
+
+	while(frame < totalFrames)
+	{
+		uint16_t frames = SYNTH_BLOCK_FRAMES;
+
+		// queue the plucks that fall in this block's window (the event clock is the board's core clock)
+		while(next < nPlucks && plucks[next].frame < frame + SYNTH_BLOCK_FRAMES)
+		{
+			event.time = (uint32_t)(uint64_t)(plucks[next].frame*(double)SCHEDULE_CYCLES_PER_FRAME);
+			event.type = (plucks[next].volume < 0) ? EVENT_FRET : EVENT_ONSET;
+			event.stringNo = plucks[next].stringNo;
+			event.fret = plucks[next].fret;
+			// on the board the knob is the codec master volume; here it scales the note (10 = 0dB)
+			event.amplitude = plucks[next].volume/10*plucks[next].velocity;
+			event.brightness = SYNTH_BRIGHTNESS(plucks[next].velocity);
+			event_push(&event);
+			next++;
+		}
+		if(frames > totalFrames - frame)
+			frames = (uint16_t)(totalFrames - frame);
+
+		// the block is played SCHEDULE_LATENCY_FRAMES after the pluck times it covers
+		start = seconds_now();
+		schedule_render(block, (uint32_t)(uint64_t)((frame + SCHEDULE_LATENCY_FRAMES)*(double)SCHEDULE_CYCLES_PER_FRAME),
+				next_noise, tuning, NOTE_DURATION);
+		renderTime += seconds_now() - start;
+
+		fwrite(block, sizeof(int16_t), 2*frames, file);
+		frame += frames;
+	}
+	fclose(file);
+
+	printf("%s: %u frames (%.2f s) in %.3f ms, %.0f samples/s (%.1fx real time)\n",
+			outName, (unsigned int)totalFrames, totalFrames/SYNTH_SAMPLE_RATE, renderTime*1000.0,
+			totalFrames/renderTime, totalFrames/renderTime/SYNTH_SAMPLE_RATE);
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: render [-e] [-t tuning] [-s seconds] out.wav [time,string,fret[,volume[,velocity]] ...]\n");
+}
+
+/*
+ * Parse "time,string,fret,volume,velocity", "time,string,fret,volume" or "time,string,fret" (time in ms)
+ */
+static int parse_pluck(const char *arg, pluck *p)
+{
+	unsigned int ms, stringNo, fret;
+	float volume = -1, velocity = 1;
+
+	if(sscanf(arg, "%u,%u,%u,%f,%f", &ms, &stringNo, &fret, &volume, &velocity) < 3)
+		return -1;
+	if(velocity < 0 || velocity > 1)
+		return -1;
+	if(stringNo < 1 || stringNo > NOTE_STRINGS || fret >= NOTE_FRETS)
+		return -1;
+
+	p->frame = (uint32_t)(ms*(SYNTH_SAMPLE_RATE/1000.0f));
+	p->stringNo = (uint8_t)stringNo;
+	p->fret = (uint8_t)fret;
+	p->volume = volume;
+	p->velocity = velocity;
+	return 0;
+}
+
+/*
+ * Fresh full scale noise burst for each pluck, as excite.c hands out from the hardware RNG
+ * (xorshift32 here so output is repeatable)
+ */
+static const int16_t *next_noise(void)
+{
+	uint32_t x = noiseSeed;
+	uint16_t n;
+
+	for(n = 0; n < SYNTH_MAX_DELAY; n++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		noiseBuffer[n] = (int16_t)(x >> 16);
+	}
+	noiseSeed = x;
+	return noiseBuffer;
+}
+
+static void put_le(FILE *file, uint32_t value, uint8_t bytes)
+{
+	while(bytes--)
+	{
+		fputc(value & 0xFF, file);
+		value >>= 8;
+	}
+}
+
+/*
+ * 16-bit stereo PCM at the board's actual frame rate
+ */
+static void write_wav_header(FILE *file, uint32_t frames)
+{
+	uint32_t rate = (uint32_t)(SYNTH_SAMPLE_RATE + 0.5f);
+	uint32_t dataBytes = frames*2*sizeof(int16_t);
+
+	fwrite("RIFF", 1, 4, file);
+	put_le(file, 36 + dataBytes, 4);
+	fwrite("WAVEfmt ", 1, 8, file);
+	put_le(file, 16, 4);					// fmt chunk size
+	put_le(file, 1, 2);						// PCM
+	put_le(file, 2, 2);						// channels
+	put_le(file, rate, 4);
+	put_le(file, rate*2*sizeof(int16_t), 4);	// byte rate
+	put_le(file, 2*sizeof(int16_t), 2);		// block align
+	put_le(file, 16, 2);					// bits per sample
+	fwrite("data", 1, 4, file);
+	put_le(file, dataBytes, 4);
+}
+
+static double seconds_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
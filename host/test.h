@@ -0,0 +1,59 @@
+//*************************************
+//
+//  header for the host tests
+//
+//*************************************
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef __TEST_H
+#define __TEST_H
+
+static unsigned int test_failures = 0;
+
+// Report and count a failed check, then carry on, so one run lists every failure
+#define CHECK(condition, ...) \
+	do \
+	{ \
+		if(!(condition)) \
+		{ \
+			if(test_failures++ < 20) \
+			{ \
+				printf("%s:%d: ", __FILE__, __LINE__); \
+				printf(__VA_ARGS__); \
+				printf("\n"); \
+			} \
+		} \
+	} while(0)
+
+/*
+ * Print the verdict; the test's exit status (0 = passed)
+ */
+static inline int test_result(const char *name)
+{
+	if(test_failures != 0)
+	{
+		printf("%s: %u checks FAILED\n", name, test_failures);
+		return 1;
+	}
+	printf("%s: passed\n", name);
+	return 0;
+}
+
+/*
+ * Repeatable xorshift32 stream for noise bursts and random cases
+ */
+static inline uint32_t test_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+
+#endif /* __TEST_H */
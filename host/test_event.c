@@ -0,0 +1,150 @@
+//*************************************
+//
+//  host test: string event queue
+//
+//	First fills the queue on one thread: EVENT_QUEUE_SIZE pushes
+//	must succeed, the next ones must be dropped and counted in
+//	event_dropped, and the kept events must come out in order.
+//	Then a producer thread stands in for the beam and fret ISRs
+//	and pushes EVENTS sequence numbered events (dropping them
+//	when the queue is full, as the ISRs do) while the main thread
+//	pops them as the renderer does. Every event that was accepted
+//	must arrive exactly once, in order and intact, and
+//	event_dropped must equal the pushes that were refused.
+//
+//	Build and run from the repository root:
+//	  gcc -O2 -std=gnu99 -Wall -pthread -Isrc -o test_event host/test_event.c src/event.c && ./test_event
+//
+//*************************************
+
+#include <pthread.h>
+#include <sched.h>
+#include "test.h"
+#include "event.h"
+
+#define EVENTS		2000000
+#define EXTRA		5			// pushes past a full queue in the single thread test
+
+static uint32_t refused = 0;	// pushes that returned 0 (producer thread)
+static volatile uint8_t producerDone = 0;
+
+/*
+ * An event whose every field is derived from its sequence number
+ */
+static void make_event(uint32_t sequence, string_event *e)
+{
+	e->time = sequence;
+	e->type = (uint8_t)(sequence % 3);
+	e->stringNo = (uint8_t)(1 + sequence % 6);
+	e->fret = (uint8_t)(sequence % 5);
+	e->amplitude = (float)(sequence & 0xFFFF);
+	e->brightness = (uint16_t)(sequence*7);
+}
+
+static int intact(const string_event *e)
+{
+	string_event expected;
+
+	make_event(e->time, &expected);
+	return e->type == expected.type && e->stringNo == expected.stringNo && e->fret == expected.fret &&
+			e->amplitude == expected.amplitude && e->brightness == expected.brightness;
+}
+
+static void test_full(void)
+{
+	string_event e;
+	uint32_t n;
+
+	event_dropped = 0;
+	for(n = 0; n < EVENT_QUEUE_SIZE + EXTRA; n++)
+	{
+		make_event(n, &e);
+		CHECK(event_push(&e) == (n < EVENT_QUEUE_SIZE), "push %u into a queue of %u returned the wrong result", n, EVENT_QUEUE_SIZE);
+	}
+	CHECK(event_dropped == EXTRA, "event_dropped = %u after %u pushes past a full queue", (unsigned int)event_dropped, EXTRA);
+
+	for(n = 0; n < EVENT_QUEUE_SIZE; n++)
+	{
+		CHECK(event_pop(&e) == 1 && e.time == n && intact(&e), "pop %u: wrong or torn event (time %u)", n, (unsigned int)e.time);
+	}
+	CHECK(event_pop(&e) == 0, "pop from an empty queue succeeded");
+
+	// room again after draining
+	make_event(0, &e);
+	CHECK(event_push(&e) == 1 && event_pop(&e) == 1, "queue unusable after being full");
+}
+
+static void *producer(void *arg)
+{
+	string_event e;
+	uint32_t n;
+
+	(void)arg;
+	for(n = 0; n < EVENTS; n++)
+	{
+		make_event(n, &e);
+		if(event_push(&e) == 0)
+		{
+			// like the ISR, drop it; let the consumer run (the host may have a single CPU)
+			refused++;
+			sched_yield();
+		}
+		if((n & 0xFF) == 0)
+			sched_yield();
+	}
+	__atomic_store_n(&producerDone, 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static void test_threads(void)
+{
+	pthread_t thread;
+	string_event e;
+	uint32_t received = 0, torn = 0, disorder = 0;
+	int64_t last = -1;
+
+	event_dropped = 0;
+	pthread_create(&thread, 0, producer, 0);
+
+	while(1)
+	{
+		if(event_pop(&e))
+		{
+			if((int64_t)e.time <= last)
+				disorder++;
+			if(!intact(&e))
+				torn++;
+			last = e.time;
+			received++;
+		}
+		else if(__atomic_load_n(&producerDone, __ATOMIC_ACQUIRE))
+		{
+			// nothing can have been pushed after producerDone
+			if(!event_pop(&e))
+				break;
+			if((int64_t)e.time <= last || !intact(&e))
+				disorder++;
+			last = e.time;
+			received++;
+		}
+		else
+		{
+			sched_yield();
+		}
+	}
+	pthread_join(thread, 0);
+
+	printf("threads: %u pushed, %u received, %u dropped\n", EVENTS, received, refused);
+	CHECK(disorder == 0, "%u events out of order or repeated", disorder);
+	CHECK(torn == 0, "%u events torn", torn);
+	CHECK(received + refused == EVENTS, "%u received + %u dropped != %u pushed", received, refused, EVENTS);
+	CHECK(event_dropped == refused, "event_dropped = %u, producer saw %u refused pushes", (unsigned int)event_dropped, refused);
+	CHECK(received > EVENTS/2, "only %u of %u events got through", received, EVENTS);
+}
+
+int main(void)
+{
+	test_full();
+	test_threads();
+	return test_result("test_event");
+}
@@ -0,0 +1,106 @@
+//*************************************
+//
+//  host test: fret ladder and note table
+//
+//	notes_fret() must give the same fret as the original 6x6
+//	if/else ladder in main.c for every 16-bit reading (so at and
+//	around each of the 32000/35000/39000/42000/60000 thresholds),
+//	and every note_table entry must fit the delay line
+//	(length < SYNTH_MAX_DELAY) with an allpass fraction d in
+//	[0.1, 1.1), the range where its phase delay is flat.
+//
+//	Build and run from the repository root:
+//	  gcc -O2 -std=gnu99 -Wall -Isrc -o test_notes host/test_notes.c src/notes.c && ./test_notes
+//
+//*************************************
+
+#include "test.h"
+#include "notes.h"
+
+static const uint16_t thresholds[] = {32000, 35000, 39000, 42000, 60000};
+
+/*
+ * The ladder as it was in main.c (the same for every string)
+ */
+static uint8_t old_fret(uint16_t adcValue)
+{
+	if(adcValue > 60000)
+		return 0;
+	else if(adcValue > 42000)
+		return 4;
+	else if(adcValue > 39000)
+		return 3;
+	else if(adcValue > 35000)
+		return 2;
+	else if(adcValue > 32000)
+		return 1;
+	else
+		return 0;
+}
+
+static void test_ladder(void)
+{
+	uint32_t value;
+	uint8_t i;
+	int8_t offset;
+
+	for(value = 0; value <= 0xFFFF; value++)
+	{
+		CHECK(notes_fret((uint16_t)value) == old_fret((uint16_t)value), "notes_fret(%u) = %u, ladder gives %u",
+				value, notes_fret((uint16_t)value), old_fret((uint16_t)value));
+	}
+
+	// spelled out at the thresholds: a reading equal to a threshold is still below it
+	for(i = 0; i < sizeof(thresholds)/sizeof(thresholds[0]); i++)
+	{
+		for(offset = -2; offset <= 2; offset++)
+		{
+			value = thresholds[i] + offset;
+			CHECK(notes_fret((uint16_t)value) == old_fret((uint16_t)value), "notes_fret(%u) = %u at threshold %u, ladder gives %u",
+					value, notes_fret((uint16_t)value), thresholds[i], old_fret((uint16_t)value));
+		}
+	}
+	CHECK(notes_fret(32000) == 0 && notes_fret(32001) == 1, "fret 1 threshold");
+	CHECK(notes_fret(42000) == 3 && notes_fret(42001) == 4, "fret 4 threshold");
+	CHECK(notes_fret(60000) == 4 && notes_fret(60001) == 0, "released threshold");
+}
+
+static void test_table(void)
+{
+	uint8_t t, s, f;
+	const ks_tuning *note;
+	double c, d;
+
+	for(t = 0; t < NOTE_TUNINGS; t++)
+	{
+		for(s = 1; s <= NOTE_STRINGS; s++)
+		{
+			for(f = 0; f < NOTE_FRETS; f++)
+			{
+				note = notes_lookup(t, s, f);
+
+				// coef = (1-d)/(1+d), as quantised to Q15
+				c = note->coef/32768.0;
+				d = (1 - c)/(1 + c);
+
+				CHECK(note->length < SYNTH_MAX_DELAY, "tuning %u string %u fret %u: length %u >= SYNTH_MAX_DELAY",
+						t, s, f, note->length);
+				CHECK(d >= 0.1 && d < 1.1,
+						"tuning %u string %u fret %u: allpass fraction %.4f outside [0.1, 1.1)", t, s, f, d);
+				CHECK(note->decay == SYNTH_DECAY, "tuning %u string %u fret %u: loop gain %d", t, s, f, note->decay);
+
+				// higher frets are higher notes
+				if(f > 0)
+					CHECK(note->length <= notes_lookup(t, s, f-1)->length, "tuning %u string %u fret %u is longer than fret %u",
+							t, s, f, f-1);
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	test_ladder();
+	test_table();
+	return test_result("test_notes");
+}
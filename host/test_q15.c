@@ -0,0 +1,106 @@
+//*************************************
+//
+//  host test: Q15 string loop against a float model
+//
+//	ks_sample() must round (a+b)/2*decay to the nearest Q15
+//	value (checked over random and extreme pairs), and a whole
+//	string run for one second in Q15 must stay within
+//	MAX_LOOP_ERROR LSB of the same loop in double precision.
+//
+//	Build and run from the repository root:
+//	  gcc -O2 -std=gnu99 -Wall -Isrc -o test_q15 host/test_q15.c -lm && ./test_q15
+//
+//*************************************
+
+#include <math.h>
+#include "test.h"
+#include "ks_kernel.h"
+#include "synth.h"
+
+#define PAIRS			1000000
+#define LOOP_LENGTH		436			// A2 at the board's frame rate
+#define LOOP_SAMPLES	48000		// one second
+#define MAX_LOOP_ERROR	20			// LSB (-64dBFS)
+
+static int16_t line[LOOP_LENGTH+1];
+static double lineModel[LOOP_LENGTH+1];
+
+/*
+ * Single sample rounding against the exact value
+ */
+static void test_sample(void)
+{
+	static const int16_t extremes[] = {-32768, -32767, -1, 0, 1, 32766, 32767};
+	static const int16_t decays[] = {SYNTH_DECAY, 32767, 16384, 1};
+	uint32_t seed = 12345;
+	uint32_t n, i, j, d;
+	int16_t a, b;
+	double exact;
+
+	for(d = 0; d < sizeof(decays)/sizeof(decays[0]); d++)
+	{
+		for(n = 0; n < PAIRS; n++)
+		{
+			a = (int16_t)test_random(&seed);
+			b = (int16_t)test_random(&seed);
+			exact = (a + b)/2.0*decays[d]/32768.0;
+			CHECK(fabs(ks_sample(a, b, decays[d]) - exact) <= 0.5,
+					"ks_sample(%d, %d, %d) = %d, exact %f", a, b, decays[d], ks_sample(a, b, decays[d]), exact);
+		}
+
+		for(i = 0; i < sizeof(extremes)/sizeof(extremes[0]); i++)
+		{
+			for(j = 0; j < sizeof(extremes)/sizeof(extremes[0]); j++)
+			{
+				exact = (extremes[i] + extremes[j])/2.0*decays[d]/32768.0;
+				CHECK(fabs(ks_sample(extremes[i], extremes[j], decays[d]) - exact) <= 0.5,
+						"ks_sample(%d, %d, %d) = %d, exact %f", extremes[i], extremes[j], decays[d],
+						ks_sample(extremes[i], extremes[j], decays[d]), exact);
+			}
+		}
+	}
+}
+
+/*
+ * One second of a plucked string, Q15 against double precision with the same noise burst
+ */
+static void test_loop(void)
+{
+	uint32_t seed = 2463534242u;
+	uint32_t n;
+	uint16_t k;
+	double error, worst = 0;
+
+	for(k = 0; k < LOOP_LENGTH; k++)
+	{
+		line[k] = (int16_t)(test_random(&seed) >> 16);
+		lineModel[k] = line[k];
+	}
+
+	// the line holds the last period; each new sample is the average of its two oldest times the loop gain
+	for(n = 0; n < LOOP_SAMPLES; n++)
+	{
+		line[LOOP_LENGTH] = ks_sample(line[0], line[1], SYNTH_DECAY);
+		lineModel[LOOP_LENGTH] = (lineModel[0] + lineModel[1])/2.0*SYNTH_DECAY/32768.0;
+
+		error = fabs(line[LOOP_LENGTH] - lineModel[LOOP_LENGTH]);
+		if(error > worst)
+			worst = error;
+
+		for(k = 0; k < LOOP_LENGTH; k++)
+		{
+			line[k] = line[k+1];
+			lineModel[k] = lineModel[k+1];
+		}
+	}
+
+	printf("loop: worst error %.2f LSB over %u samples\n", worst, LOOP_SAMPLES);
+	CHECK(worst <= MAX_LOOP_ERROR, "Q15 loop drifted %.2f LSB from the float model (limit %d)", worst, MAX_LOOP_ERROR);
+}
+
+int main(void)
+{
+	test_sample();
+	test_loop();
+	return test_result("test_q15");
+}
@@ -0,0 +1,175 @@
+//*************************************
+//
+//  host test: sample accurate note scheduling
+//
+//	Queues plucks at known event clock times, the way the beam
+//	interrupt does, renders through schedule_render with each
+//	block's start time computed as on the board, and checks that
+//	every note starts within one sample of its pluck frame.
+//	The plucks fall on the first, second, middle and last frames
+//	of a block, are queued just before their block or several
+//	blocks ahead, and are repeated across the 32-bit wrap of the
+//	event clock (every 25.6 s at 168MHz), both with the clock
+//	starting at 0 and starting just below the wrap.
+//	Each pluck is also repeated queued behind a pluck or a fret
+//	change on another string that falls just after its block, so
+//	the queue is out of time order; the pluck must not wait for it.
+//
+//	Build and run from the repository root:
+//	  gcc -O2 -std=gnu99 -Wall -Isrc -o test_schedule host/test_schedule.c src/schedule.c src/event.c src/synth.c src/ks_kernel.c src/notes.c && ./test_schedule
+//
+//*************************************
+
+#include "test.h"
+#include "synth.h"
+#include "notes.h"
+#include "event.h"
+#include "schedule.h"
+
+#define DURATION		100			// samples a test note rings for
+#define WRAP_FRAMES		((uint64_t)(4294967296.0/SCHEDULE_CYCLES_PER_FRAME))	// frames per event clock wrap
+
+static const uint16_t offsets[] = { 0, 1, 2, 31, 32, 62, 63 };	// pluck frame within its block
+static const uint8_t leads[] = { 0, 1, 3 };						// blocks queued ahead of the pluck's block
+
+// what the pluck is queued behind: an event one frame into the next block, on another string
+enum
+{
+	BEHIND_NOTHING = 0,
+	BEHIND_PLUCK,
+	BEHIND_FRET,			// on a silent string, so it changes nothing
+	BEHIND_CASES
+};
+static const char *behindNames[BEHIND_CASES] = { "", ", behind a later pluck", ", behind a fret change" };
+
+static int16_t noise[SYNTH_MAX_DELAY];
+static int16_t block[2*SYNTH_BLOCK_FRAMES];
+static uint64_t frame = 0;			// frames rendered so far
+static uint32_t clockBase;			// event clock at frame 0
+static uint32_t cases = 0;
+
+static const int16_t *next_noise(void)
+{
+	return noise;
+}
+
+/*
+ * Event clock time of a frame, wrapping as DWT->CYCCNT does
+ */
+static uint32_t frame_time(uint64_t f)
+{
+	return clockBase + (uint32_t)(uint64_t)(f*(double)SCHEDULE_CYCLES_PER_FRAME);
+}
+
+/*
+ * Render the next block (played SCHEDULE_LATENCY_FRAMES after the pluck times it covers),
+ * returning the first frame with sound in it, or -1
+ */
+static int64_t render_block(void)
+{
+	uint16_t i;
+	int64_t first = -1;
+
+	schedule_render(block, frame_time(frame + SCHEDULE_LATENCY_FRAMES), next_noise, TUNING_STANDARD, DURATION);
+	for(i = 0; i < SYNTH_BLOCK_FRAMES; i++)
+	{
+		if(first < 0 && (block[2*i] != 0 || block[2*i+1] != 0))
+			first = (int64_t)(frame + i);
+	}
+	frame += SYNTH_BLOCK_FRAMES;
+	return first;
+}
+
+/*
+ * Pluck a string at frame target, queued lead blocks before its block is rendered
+ * (behind a later event on another string, see BEHIND_*), and check where the note starts
+ */
+static void test_pluck(uint64_t target, uint8_t lead, uint8_t stringNo, uint8_t behind)
+{
+	string_event e;
+	uint64_t queueAt = target - target % SYNTH_BLOCK_FRAMES - lead*SYNTH_BLOCK_FRAMES;
+	int64_t first, heard = -1;
+
+	// silence up to the pluck (the last note has died away)
+	while(frame < queueAt)
+	{
+		first = render_block();
+		CHECK(first < 0, "sound at frame %lld before the pluck at %llu", (long long)first, (unsigned long long)target);
+	}
+
+	e.stringNo = (uint8_t)(stringNo % NOTE_STRINGS + 1);
+	e.fret = 0;
+	e.amplitude = 1.0f;
+	e.brightness = SYNTH_BRIGHTNESS(1.0f);
+	e.time = frame_time(target - target % SYNTH_BLOCK_FRAMES + SYNTH_BLOCK_FRAMES + 1);
+	if(behind != BEHIND_NOTHING)
+	{
+		e.type = (behind == BEHIND_PLUCK) ? EVENT_ONSET : EVENT_FRET;
+		CHECK(event_push(&e) == 1, "queue full");
+	}
+
+	e.time = frame_time(target);
+	e.type = EVENT_ONSET;
+	e.stringNo = stringNo;
+	CHECK(event_push(&e) == 1, "queue full");
+
+	// the note, the one behind it and their tails
+	while(frame < target + DURATION + 2*SYNTH_BLOCK_FRAMES)
+	{
+		first = render_block();
+		if(heard < 0)
+			heard = first;
+	}
+
+	cases++;
+	CHECK(heard >= 0 && heard >= (int64_t)target-1 && heard <= (int64_t)target+1,
+			"pluck at frame %llu (event time %u, lead %u blocks%s) started at frame %lld",
+			(unsigned long long)target, (unsigned int)e.time, lead, behindNames[behind], (long long)heard);
+}
+
+/*
+ * Plucks at every offset and lead around frame near
+ */
+static void test_around(uint64_t near)
+{
+	uint64_t blockStart = near - near % SYNTH_BLOCK_FRAMES;
+	uint8_t o, l, b, stringNo = 1;
+
+	// leave room for the longest lead and the previous note to die away
+	blockStart -= 8*SYNTH_BLOCK_FRAMES;
+	for(b = 0; b < BEHIND_CASES; b++)
+	{
+		for(l = 0; l < sizeof(leads); l++)
+		{
+			for(o = 0; o < sizeof(offsets)/sizeof(offsets[0]); o++)
+			{
+				if(blockStart < frame + 4*SYNTH_BLOCK_FRAMES)
+					blockStart = frame - frame % SYNTH_BLOCK_FRAMES + 8*SYNTH_BLOCK_FRAMES;
+				test_pluck(blockStart + offsets[o], leads[l], stringNo, b);
+				stringNo = (uint8_t)(stringNo % NOTE_STRINGS + 1);
+				blockStart += 8*SYNTH_BLOCK_FRAMES;
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	uint16_t n;
+
+	for(n = 0; n < SYNTH_MAX_DELAY; n++)
+		noise[n] = 16384;
+
+	// event clock starting at 0: near the start and across the first wrap (25.6s)
+	clockBase = 0;
+	test_around(1000);
+	test_around(WRAP_FRAMES);
+
+	// event clock starting just below the wrap
+	clockBase = 0xFFFFFFFF - (uint32_t)(300*SCHEDULE_CYCLES_PER_FRAME);
+	test_around(frame + 300);
+	test_around(frame + 2*WRAP_FRAMES);
+
+	printf("%u plucks, %llu frames (%.1f s)\n", cases, (unsigned long long)frame, frame/SYNTH_SAMPLE_RATE);
+	return test_result("test_schedule");
+}
@@ -0,0 +1,290 @@
+//*************************************
+//
+//  host test: circular delay lines against the two-buffer string
+//
+//	Before the circular line, each voice kept the previous
+//	period in DACBuffer, built the next one in tempBuffer and
+//	copied it back every period. That recurrence is kept here as
+//	the reference model (with the allpass, pluck lowpass, gain
+//	and electric clipping added since), and synth.c must render
+//	bit-identical output to it for random plucks on every voice,
+//	random block sizes, note lengths and electric mode toggles.
+//	Retuning (synth_retune) has no two-buffer equivalent, so it is
+//	checked on its own: pull-offs and hammer-ons right after a
+//	pluck and again in the middle of the crossfade must not pick up
+//	what the previous note left in the delay line (a string plucked
+//	with a negative burst after a positive note must stay negative)
+//	and must not make the output jump (a string holding one smooth
+//	cycle per period must stay smooth through both crossfades).
+//
+//	Build and run from the repository root:
+//	  gcc -O2 -std=gnu99 -Wall -Isrc -o test_synth host/test_synth.c src/synth.c src/ks_kernel.c src/notes.c -lm && ./test_synth
+//	Add -D__ARM_FEATURE_DSP=1 -Ihost/dsp to run the voices on the packed kernel (see host/test_kernel.c).
+//
+//*************************************
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include "test.h"
+#include "synth.h"
+#include "notes.h"
+#include "ks_kernel.h"
+
+#define BLOCKS				20000
+#define RETUNE_FRAMES		4096		// frames rendered after each retune
+#define SINE_LEVEL			16000		// peak of the smooth test cycle
+#define ELECTRIC_THRESHOLD	(-5888)		// as synth.c
+#define ELECTRIC_LEVEL		13312
+
+typedef struct
+{
+	int16_t DACBuffer[SYNTH_MAX_DELAY];		// previous period of the string
+	int16_t tempBuffer[SYNTH_MAX_DELAY];	// period currently being synthesized
+	uint16_t length;
+	uint16_t index;							// position within the current period
+	int16_t coef;
+	int16_t decay;
+	int32_t apIn;
+	int32_t apOut;
+	uint32_t remaining;
+	int32_t gain;
+} ref_voice;
+
+static ref_voice refVoices[SYNTH_VOICES];
+static uint8_t refElectric = 0;
+static int16_t noise[SYNTH_MAX_DELAY];
+
+static void ref_pluck(uint8_t voiceNo, const int16_t excitation[], const ks_tuning *tuning, float amplitude, uint16_t brightness, uint32_t duration)
+{
+	ref_voice *voice = &refVoices[voiceNo];
+	uint16_t delayLength = tuning->length;
+	int32_t filtered = 0;
+	uint16_t n;
+
+	if(delayLength > SYNTH_MAX_DELAY)
+		delayLength = SYNTH_MAX_DELAY;
+
+	for(n = 0; n < delayLength; n++)
+	{
+		filtered += (brightness*(excitation[n] - filtered)) >> 15;
+		voice->DACBuffer[n] = (int16_t)filtered;
+	}
+
+	voice->length = delayLength;
+	voice->index = 0;
+	voice->coef = tuning->coef;
+	voice->decay = tuning->decay;
+	voice->apIn = 0;
+	voice->apOut = 0;
+	voice->gain = (int32_t)(amplitude*SYNTH_LEVEL);
+	voice->remaining = duration;
+}
+
+/*
+ * Next sample of a string, one at a time
+ */
+static int32_t ref_sample(ref_voice *voice)
+{
+	uint16_t j = voice->index;
+	int32_t value, apOut;
+
+	// the last sample of the period averages with the first sample of the new one
+	if(j != voice->length-1)
+		value = ks_sample(voice->DACBuffer[j], voice->DACBuffer[j+1], voice->decay);
+	else
+		value = ks_sample(voice->DACBuffer[j], voice->tempBuffer[0], voice->decay);
+
+	apOut = ((voice->coef*(value - voice->apOut) + 0x4000) >> 15) + voice->apIn;
+	voice->apIn = value;
+	if(apOut > 32767)
+		apOut = 32767;
+	else if(apOut < -32768)
+		apOut = -32768;
+	voice->apOut = apOut;
+	voice->tempBuffer[j] = (int16_t)apOut;
+
+	j++;
+	if(j == voice->length)
+	{
+		memcpy(voice->DACBuffer, voice->tempBuffer, voice->length*sizeof(int16_t));
+		j = 0;
+	}
+	voice->index = j;
+	voice->remaining--;
+
+	if(refElectric == 1 && apOut < ELECTRIC_THRESHOLD)
+		apOut = ELECTRIC_LEVEL;
+	return (apOut*voice->gain) >> 15;
+}
+
+static void ref_render(int16_t outBuffer[], uint16_t frames)
+{
+	uint16_t i;
+	uint8_t v;
+	int32_t sample;
+
+	for(i = 0; i < frames; i++)
+	{
+		sample = 0;
+		for(v = 0; v < SYNTH_VOICES; v++)
+		{
+			if(refVoices[v].remaining > 0)
+				sample += ref_sample(&refVoices[v]);
+		}
+		if(sample > 32767)
+			sample = 32767;
+		else if(sample < -32768)
+			sample = -32768;
+		outBuffer[2*i] = (int16_t)sample;
+		outBuffer[2*i+1] = (int16_t)sample;
+	}
+}
+
+/*
+ * Render frames frames of voice 0 (the others silent); returns the largest step between
+ * consecutive samples, and the largest sample in *peak
+ */
+static int32_t render_voice(uint32_t frames, int32_t *last, int32_t *peak)
+{
+	int16_t out[2*SYNTH_BLOCK_FRAMES];
+	int32_t step = 0;
+	uint16_t n, count;
+
+	while(frames > 0)
+	{
+		count = (frames > SYNTH_BLOCK_FRAMES) ? SYNTH_BLOCK_FRAMES : (uint16_t)frames;
+		synth_render(out, count);
+		for(n = 0; n < count; n++)
+		{
+			if(abs(out[2*n] - *last) > step)
+				step = abs(out[2*n] - *last);
+			if(out[2*n] > *peak)
+				*peak = out[2*n];
+			*last = out[2*n];
+		}
+		frames -= count;
+	}
+	return step;
+}
+
+/*
+ * Pluck string stringNo at fret from, retune it to fret to straight away and then to fret again
+ * after delay frames (inside the first crossfade when delay < SYNTH_FADE_FRAMES)
+ */
+static void test_retune(uint8_t stringNo, uint8_t from, uint8_t to, uint8_t again, uint16_t delay)
+{
+	const ks_tuning *start = notes_lookup(TUNING_STANDARD, stringNo, from);
+	int32_t last = 0, peak = -32768, step, limit;
+	uint16_t n;
+
+	// a loud positive note fills the whole line first
+	for(n = 0; n < SYNTH_MAX_DELAY; n++)
+		noise[n] = 20000;
+	synth_pluck(0, noise, notes_lookup(TUNING_STANDARD, 6, 0), 1.0f, 32768, 4*SYNTH_LINE_SIZE);
+	render_voice(4*SYNTH_LINE_SIZE, &last, &peak);
+
+	// negative burst: every sample of the note stays below zero unless it reads the old note
+	for(n = 0; n < SYNTH_MAX_DELAY; n++)
+		noise[n] = -20000;
+	synth_pluck(0, noise, start, 1.0f, 32768, 2*RETUNE_FRAMES);
+	render_voice(1, &last, &peak);			// (the allpass starts from rest, so the first sample can overshoot)
+	peak = -32768;
+	synth_retune(0, notes_lookup(TUNING_STANDARD, stringNo, to));
+	render_voice(delay, &last, &peak);
+	synth_retune(0, notes_lookup(TUNING_STANDARD, stringNo, again));
+	render_voice(RETUNE_FRAMES, &last, &peak);
+	CHECK(peak < 0, "string %u fret %u -> %u -> %u (after %u frames): output %d reads the previous note",
+			stringNo, from, to, again, delay, (int)peak);
+
+	// one cycle per period: the output may only move as fast as the cycle and the crossfade allow
+	for(n = 0; n < start->length; n++)
+		noise[n] = (int16_t)(SINE_LEVEL*sin(2*M_PI*n/start->length));
+	synth_pluck(0, noise, start, 1.0f, 32768, 2*RETUNE_FRAMES);
+	last = 0;
+	render_voice(1, &last, &peak);
+	synth_retune(0, notes_lookup(TUNING_STANDARD, stringNo, to));
+	step = render_voice(delay, &last, &peak);
+	synth_retune(0, notes_lookup(TUNING_STANDARD, stringNo, again));
+	n = (uint16_t)render_voice(RETUNE_FRAMES, &last, &peak);
+	if(n > step)
+		step = n;
+
+	limit = (int32_t)(SINE_LEVEL*(double)SYNTH_LEVEL/32768*(2*M_PI/notes_lookup(TUNING_STANDARD, stringNo, 4)->length + 4.0/SYNTH_FADE_FRAMES)) + 32;
+	CHECK(step <= limit, "string %u fret %u -> %u -> %u (after %u frames): output jumps by %d (at most %d expected)",
+			stringNo, from, to, again, delay, (int)step, (int)limit);
+
+	synth_pluck(0, noise, start, 0, 32768, 0);
+}
+
+int main(void)
+{
+	uint32_t seed = 521288629;
+	uint32_t block, samples = 0;
+	uint16_t frames, n;
+	int16_t out[2*SYNTH_BLOCK_FRAMES], expected[2*SYNTH_BLOCK_FRAMES];
+	ks_tuning tuning;
+	uint8_t voiceNo, electric;
+	float amplitude;
+	uint16_t brightness;
+	uint32_t duration;
+	static const uint16_t delays[] = { 0, 1, 10, 32, 63, 64, 200 };
+	uint8_t stringNo, d;
+
+	// pull-offs and hammer-ons, the second one inside or after the first crossfade
+	for(stringNo = 1; stringNo <= NOTE_STRINGS; stringNo++)
+	{
+		for(d = 0; d < sizeof(delays)/sizeof(delays[0]); d++)
+		{
+			test_retune(stringNo, 4, 0, 2, delays[d]);		// longer, then shorter
+			test_retune(stringNo, 0, 4, 2, delays[d]);		// shorter, then longer
+			test_retune(stringNo, 4, 2, 0, delays[d]);		// longer twice
+			test_retune(stringNo, 0, 2, 4, delays[d]);		// shorter twice
+		}
+	}
+
+	for(block = 0; block < BLOCKS; block++)
+	{
+		// about one pluck every 8 blocks, on any string, from the note table or any length
+		if(test_random(&seed) % 8 == 0)
+		{
+			voiceNo = (uint8_t)(test_random(&seed) % SYNTH_VOICES);
+			if(test_random(&seed) % 2 == 0)
+			{
+				tuning = note_table[test_random(&seed) % NOTE_TUNINGS][test_random(&seed) % NOTE_STRINGS][test_random(&seed) % NOTE_FRETS];
+			}
+			else
+			{
+				tuning.length = (uint16_t)(2 + test_random(&seed) % (SYNTH_MAX_DELAY + 100));
+				tuning.coef = (int16_t)(test_random(&seed) % 28000) - 1600;		// d in about [0.1, 1.1)
+				tuning.decay = SYNTH_DECAY;
+			}
+			for(n = 0; n < SYNTH_MAX_DELAY; n++)
+			{
+				noise[n] = (int16_t)test_random(&seed);
+			}
+			amplitude = (test_random(&seed) % 1001)/1000.0f;
+			brightness = (uint16_t)(test_random(&seed) % 32769);
+			duration = 1 + test_random(&seed) % 20000;
+
+			synth_pluck(voiceNo, noise, &tuning, amplitude, brightness, duration);
+			ref_pluck(voiceNo, noise, &tuning, amplitude, brightness, duration);
+		}
+
+		if(test_random(&seed) % 50 == 0)
+		{
+			electric = (uint8_t)(test_random(&seed) & 1);
+			synth_set_electric(electric);
+			refElectric = electric;
+		}
+
+		frames = (uint16_t)(1 + test_random(&seed) % SYNTH_BLOCK_FRAMES);
+		synth_render(out, frames);
+		ref_render(expected, frames);
+		CHECK(memcmp(out, expected, 2*frames*sizeof(int16_t)) == 0, "block %u (%u frames) differs from the two-buffer model", block, frames);
+		samples += frames;
+	}
+
+	printf("compared %u frames\n", samples);
+	return test_result("test_synth");
+}
@@ -0,0 +1,154 @@
+//*************************************
+//
+//  host test: pitch of every note in note_table
+//
+//	Plucks each entry of all three tunings on its own, renders
+//	RENDER_FRAMES through synth_render and finds the fundamental
+//	as the peak of the Hann windowed spectrum (searched on a
+//	continuous frequency axis, not just at FFT bins). Every note
+//	must be within MAX_CENTS of its equal tempered frequency at
+//	the board's frame rate, SYNTH_SAMPLE_RATE.
+//
+//	Build and run from the repository root:
+//	  gcc -O2 -std=gnu99 -Wall -Isrc -o test_tuning host/test_tuning.c src/synth.c src/ks_kernel.c src/notes.c -lm && ./test_tuning
+//
+//*************************************
+
+#include <math.h>
+#include "test.h"
+#include "synth.h"
+#include "notes.h"
+
+#define RENDER_FRAMES	65536		// 1.37s
+#define MAX_CENTS		2.0
+#define SEARCH_CENTS	30.0		// inside the window's main lobe for the lowest note
+
+// open strings from string 1 (high) to string 6 (low), Hz (independent of notes.c)
+static const double openStrings[NOTE_TUNINGS][NOTE_STRINGS] =
+{
+	{329.6276, 246.9417, 195.9977, 146.8324, 110.0000, 82.4069},	// standard
+	{329.6276, 246.9417, 195.9977, 146.8324, 110.0000, 73.4162},	// drop D
+	{293.6648, 246.9417, 195.9977, 146.8324,  97.9989, 73.4162},	// open G
+};
+static const char *tuningNames[NOTE_TUNINGS] = {"standard", "drop D", "open G"};
+
+static float samples[RENDER_FRAMES];
+static double window[RENDER_FRAMES];
+static int16_t noise[SYNTH_MAX_DELAY];
+
+/*
+ * Windowed spectrum magnitude (squared) at frequency f, with a rotating phasor instead of sin/cos per sample
+ */
+static double magnitude(double f)
+{
+	double w = 2*M_PI*f/SYNTH_SAMPLE_RATE;
+	double stepRe = cos(w), stepIm = -sin(w);
+	double re = 1, im = 0, t, sumRe = 0, sumIm = 0;
+	uint32_t n;
+
+	for(n = 0; n < RENDER_FRAMES; n++)
+	{
+		sumRe += samples[n]*window[n]*re;
+		sumIm += samples[n]*window[n]*im;
+		t = re*stepRe - im*stepIm;
+		im = re*stepIm + im*stepRe;
+		re = t;
+	}
+	return sumRe*sumRe + sumIm*sumIm;
+}
+
+/*
+ * Peak of the spectrum within SEARCH_CENTS of expected: coarse scan, then golden section
+ */
+static double fundamental(double expected)
+{
+	const double golden = 0.6180339887498949;
+	double best = 0, bestCents = 0, cents, value;
+	double lo, hi, a, b, fa, fb;
+
+	for(cents = -SEARCH_CENTS; cents <= SEARCH_CENTS; cents += 1.0)
+	{
+		value = magnitude(expected*pow(2, cents/1200));
+		if(value > best)
+		{
+			best = value;
+			bestCents = cents;
+		}
+	}
+
+	lo = bestCents - 1.0;
+	hi = bestCents + 1.0;
+	a = hi - golden*(hi - lo);
+	b = lo + golden*(hi - lo);
+	fa = magnitude(expected*pow(2, a/1200));
+	fb = magnitude(expected*pow(2, b/1200));
+	while(hi - lo > 0.001)
+	{
+		if(fa > fb)
+		{
+			hi = b;
+			b = a;
+			fb = fa;
+			a = hi - golden*(hi - lo);
+			fa = magnitude(expected*pow(2, a/1200));
+		}
+		else
+		{
+			lo = a;
+			a = b;
+			fa = fb;
+			b = lo + golden*(hi - lo);
+			fb = magnitude(expected*pow(2, b/1200));
+		}
+	}
+	return expected*pow(2, (lo + hi)/2/1200);
+}
+
+int main(void)
+{
+	uint32_t seed = 3141592653u;
+	int16_t block[2*SYNTH_BLOCK_FRAMES];
+	uint32_t frame, n;
+	uint8_t t, s, f;
+	double expected, measured, cents, worst = 0;
+
+	for(n = 0; n < RENDER_FRAMES; n++)
+	{
+		window[n] = 0.5 - 0.5*cos(2*M_PI*n/(RENDER_FRAMES-1));
+	}
+
+	for(t = 0; t < NOTE_TUNINGS; t++)
+	{
+		for(s = 1; s <= NOTE_STRINGS; s++)
+		{
+			for(f = 0; f < NOTE_FRETS; f++)
+			{
+				for(n = 0; n < SYNTH_MAX_DELAY; n++)
+				{
+					noise[n] = (int16_t)test_random(&seed);
+				}
+				synth_pluck(0, noise, notes_lookup(t, s, f), 1.0f, 32768, RENDER_FRAMES);
+
+				for(frame = 0; frame < RENDER_FRAMES; frame += SYNTH_BLOCK_FRAMES)
+				{
+					synth_render(block, SYNTH_BLOCK_FRAMES);
+					for(n = 0; n < SYNTH_BLOCK_FRAMES; n++)
+					{
+						samples[frame+n] = block[2*n];
+					}
+				}
+
+				expected = openStrings[t][s-1]*pow(2, f/12.0);
+				measured = fundamental(expected);
+				cents = 1200*log2(measured/expected);
+				if(fabs(cents) > worst)
+					worst = fabs(cents);
+				CHECK(fabs(cents) <= MAX_CENTS, "%s string %u fret %u: %.3f Hz, expected %.3f Hz (%+.2f cents)",
+						tuningNames[t], s, f, measured, expected, cents);
+			}
+		}
+	}
+
+	printf("worst pitch error %.3f cents over %u notes\n", worst, NOTE_TUNINGS*NOTE_STRINGS*NOTE_FRETS);
+	return test_result("test_tuning");
+}
@@ -0,0 +1,82 @@
+//*************************************
+//
+//  DMA audio output
+//
+//	SPI3 (I2S) is fed from a circular DMA1 buffer split into two
+//	halves. The half-transfer and transfer-complete interrupts
+//	hand the half that has just been played back for re-filling,
+//	so samples are synthesized only when the codec needs them.
+//	The interrupt also notes the cycle count, from which the time
+//	the re-filled half will start playing is known to within the
+//	interrupt latency (see schedule.c), and pends PendSV, which
+//	renders the half at the lowest priority (see main.c).
+//
+//*************************************
+
+#include "audio.h"
+#include "stm32f4_discovery_audio_codec.h"
+#include "schedule.h"
+
+static int16_t audioBuffer[AUDIO_BUFFER_SIZE];
+static int16_t * volatile pendingBlock = 0;		// half of audioBuffer waiting to be re-filled
+static volatile uint32_t pendingTime = 0;		// DWT->CYCCNT when the other half started playing
+volatile uint32_t audio_underruns = 0;			// blocks that were not rendered in time
+
+/*
+ * Start streaming audioBuffer to the codec (I2S must already be set up)
+ */
+void audio_init(void)
+{
+	Audio_MAL_Init();
+	Audio_MAL_Play((uint32_t)audioBuffer, sizeof(audioBuffer));
+}
+
+/*
+ * Returns the half of the output buffer that needs to be filled
+ * with SYNTH_BLOCK_FRAMES frames, or 0 if both halves are up to date.
+ * startTime is set to the cycle count at which that half will start playing.
+ */
+int16_t *audio_next_block(uint32_t *startTime)
+{
+	int16_t *block;
+
+	__disable_irq();
+	block = pendingBlock;
+	pendingBlock = 0;
+	*startTime = pendingTime + (uint32_t)(SYNTH_BLOCK_FRAMES*SCHEDULE_CYCLES_PER_FRAME);
+	__enable_irq();
+
+	return block;
+}
+
+/*
+ * Callbacks used by stm32f4_discovery_audio_codec.c (DMA1 stream 7 interrupt).
+ * Refer to stm32f4_discovery_audio_codec.h for more info.
+ */
+void EVAL_AUDIO_HalfTransfer_CallBack(uint32_t pBuffer, uint32_t Size)
+{
+	// first half has been played while the second one is being sent
+	if(pendingBlock != 0)
+		audio_underruns++;
+	pendingBlock = &audioBuffer[0];
+	pendingTime = DWT->CYCCNT;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+void EVAL_AUDIO_TransferComplete_CallBack(uint32_t pBuffer, uint32_t Size)
+{
+	// second half has been played, DMA wraps around to the first one
+	if(pendingBlock != 0)
+		audio_underruns++;
+	pendingBlock = &audioBuffer[AUDIO_BUFFER_SIZE/2];
+	pendingTime = DWT->CYCCNT;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/*
+ * Only called when the I2S interrupt is used instead of DMA
+ */
+uint16_t EVAL_AUDIO_GetSampleCallBack(void)
+{
+	return 0;
+}
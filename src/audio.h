@@ -0,0 +1,23 @@
+//*************************************
+//
+//  header for DMA audio output
+//
+//*************************************
+
+#include <stdint.h>
+#include "synth.h"
+
+#ifndef __AUDIO_H
+#define __AUDIO_H
+
+// circular DMA buffer holding two blocks of interleaved L/R samples (ping-pong)
+#define AUDIO_BUFFER_SIZE	(2*2*SYNTH_BLOCK_FRAMES)
+
+extern volatile uint32_t audio_underruns;
+
+//function prototypes
+void audio_init(void);
+int16_t *audio_next_block(uint32_t *startTime);
+
+
+#endif /* __AUDIO_H */
@@ -0,0 +1,249 @@
+//*************************************
+//
+//  laser beam (string) detection
+//
+//	The six photodiodes share one input (PA1) through the
+//	multiplexer, so the strings are sampled in turn instead of
+//	waiting on an edge of whichever one is selected:
+//	- TIM8 update (100kHz) makes DMA2 stream 1 copy the next
+//	  select word into GPIOE->BSRR (no CPU time).
+//	- TIM8 CC1, 7.5us later when the multiplexer output has
+//	  settled, triggers one ADC2 conversion of PA1 which DMA2
+//	  stream 2 stores in scanBuffer.
+//	Both streams step through their buffers in lock step, so
+//	entry n of scanBuffer is multiplexer input n%6. Each half
+//	of scanBuffer holds BEAM_SCANS passes over all strings; its
+//	interrupt runs every string through a hysteresis comparator
+//	and queues an onset or release event (see event.c) stamped
+//	with the time of the sample that crossed the threshold,
+//	together with the fret at that moment. How long
+//	the level took to rise from CLEAR to BROKEN gives the pluck
+//	velocity, which sets the note amplitude and how bright its
+//	excitation is (both worked out here, once per pluck). Every
+//	string is seen every 60us and reported within 240us, and
+//	several strings can be broken at once.
+//
+//*************************************
+
+#include "beam.h"
+#include "stm32f4xx.h"
+#include "profile.h"
+#include "event.h"
+#include "controls.h"
+#include "synth.h"
+
+#define MUX_INPUTS		6
+#define SCAN_SIZE		(2*BEAM_SCANS*MUX_INPUTS)
+#define SCAN_PERIOD		1680		// TIM8 period: one sample every 10us (core and TIM8 clocks are both 168MHz)
+
+// Multiplexer select pins for inputs 0-5 (PE7 = bit 0, PE9 = bit 1, PE11 = bit 2) as 32-bit BSRR words:
+// set bits in the low half, reset bits in the high half.
+#define MUX_BSRR(input)	(((input) & 1 ? GPIO_Pin_7 : (uint32_t)GPIO_Pin_7 << 16) | \
+						 ((input) & 2 ? GPIO_Pin_9 : (uint32_t)GPIO_Pin_9 << 16) | \
+						 ((input) & 4 ? GPIO_Pin_11 : (uint32_t)GPIO_Pin_11 << 16))
+
+static const uint32_t muxBSRR[MUX_INPUTS] = {MUX_BSRR(0), MUX_BSRR(1), MUX_BSRR(2), MUX_BSRR(3), MUX_BSRR(4), MUX_BSRR(5)};
+
+// string wired to each multiplexer input
+static const uint8_t inputString[MUX_INPUTS] = {6, 5, 4, 3, 2, 1};
+
+static uint16_t scanBuffer[SCAN_SIZE];
+volatile uint32_t beam_held = 0;
+static uint8_t rising = 0;					// strings between CLEAR and BROKEN, not held yet
+static uint32_t riseStart[BEAM_STRINGS+1];	// time each of those went above CLEAR
+
+static void beam_scan(const uint16_t scan[]);
+static float beam_velocity(uint32_t riseTime);
+
+/*
+ * Start scanning the strings
+ */
+void beam_init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStructure;
+	DMA_InitTypeDef DMA_InitStructure;
+	ADC_InitTypeDef ADC_InitStructure;
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+	TIM_OCInitTypeDef TIM_OCInitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA|RCC_AHB1Periph_GPIOE|RCC_AHB1Periph_DMA2, ENABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM8|RCC_APB2Periph_ADC2, ENABLE);
+
+	/* Multiplexer output: PA1 (ADC123 channel 1) */
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_1;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AN;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+	GPIO_Init(GPIOA, &GPIO_InitStructure);
+
+	/* Multiplexer select pins: PE7, PE9, PE11 */
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_7 | GPIO_Pin_9 | GPIO_Pin_11;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_OUT;
+	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_UP;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(GPIOE, &GPIO_InitStructure);
+
+	// select words: TIM8 update -> DMA2 stream 1 channel 7 (only DMA2 can write to GPIO)
+	DMA_InitStructure.DMA_Channel = DMA_Channel_7;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&GPIOE->BSRRL;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)muxBSRR;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStructure.DMA_BufferSize = MUX_INPUTS;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Word;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Word;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_Full;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(DMA2_Stream1, &DMA_InitStructure);
+	DMA_Cmd(DMA2_Stream1, ENABLE);
+
+	// photodiode levels: ADC2 -> DMA2 stream 2 channel 1, interrupt on each half
+	DMA_InitStructure.DMA_Channel = DMA_Channel_1;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC2->DR;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (uint32_t)scanBuffer;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_BufferSize = SCAN_SIZE;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_Init(DMA2_Stream2, &DMA_InitStructure);
+	DMA_ITConfig(DMA2_Stream2, DMA_IT_HT | DMA_IT_TC, ENABLE);
+	DMA_Cmd(DMA2_Stream2, ENABLE);
+
+	// one conversion per TIM8 CC1 event (ADC_CommonInit() is done with ADC1 in controls.c)
+	ADC_InitStructure.ADC_Resolution = ADC_Resolution_12b;
+	ADC_InitStructure.ADC_ScanConvMode = DISABLE;
+	ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;
+	ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+	ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T8_CC1;
+	ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
+	ADC_InitStructure.ADC_NbrOfConversion = 1;
+	ADC_Init(ADC2, &ADC_InitStructure);
+	ADC_RegularChannelConfig(ADC2, ADC_Channel_1, 1, ADC_SampleTime_56Cycles);
+	ADC_DMARequestAfterLastTransferCmd(ADC2, ENABLE);
+	ADC_DMACmd(ADC2, ENABLE);
+	ADC_Cmd(ADC2, ENABLE);
+
+	NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream2_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	// TIM8: 100kHz (168MHz timer clock), select on update, sample on CC1
+	TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+	TIM_TimeBaseStructure.TIM_Period = SCAN_PERIOD-1;
+	TIM_TimeBaseStructure.TIM_Prescaler = 1-1;
+	TIM_TimeBaseStructure.TIM_ClockDivision = 0;
+	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(TIM8, &TIM_TimeBaseStructure);
+
+	// PWM mode 2: OC1REF rises at CCR1, which is the ADC trigger edge
+	TIM_OCStructInit(&TIM_OCInitStructure);
+	TIM_OCInitStructure.TIM_OCMode = TIM_OCMode_PWM2;
+	TIM_OCInitStructure.TIM_OutputState = TIM_OutputState_Enable;
+	TIM_OCInitStructure.TIM_Pulse = 1260;
+	TIM_OC1Init(TIM8, &TIM_OCInitStructure);
+	TIM_CtrlPWMOutputs(TIM8, ENABLE);		// needed for the trigger; PC6 is not in AF mode so nothing is driven
+
+	TIM_DMACmd(TIM8, TIM_DMA_Update, ENABLE);
+
+	// select input 0 now, so the first conversion (and scanBuffer[0]) is input 0
+	TIM_GenerateEvent(TIM8, TIM_EventSource_Update);
+	TIM_Cmd(TIM8, ENABLE);
+}
+
+/*
+ * Compare every sample in one half of scanBuffer against the thresholds
+ */
+static void beam_scan(const uint16_t scan[])
+{
+	uint8_t held = (uint8_t)beam_held;
+	uint32_t now = DWT->CYCCNT;
+	string_event event;
+	uint8_t n, bit;
+	float velocity;
+
+	for(n = 0; n < SCAN_SIZE/2; n++)
+	{
+		event.stringNo = inputString[n % MUX_INPUTS];
+		bit = BEAM_STRING_BIT(event.stringNo);
+
+		// the last sample of the half was converted just before this interrupt
+		event.time = now - (SCAN_SIZE/2-1 - n)*SCAN_PERIOD;
+
+		if((held & bit) == 0 && scan[n] > BEAM_BROKEN_LEVEL)
+		{
+			held |= bit;
+			event.type = EVENT_ONSET;
+
+			// cut straight through to BROKEN between two samples: as fast as can be measured
+			velocity = beam_velocity((rising & bit) ? event.time - riseStart[event.stringNo] : 0);
+			rising &= ~bit;
+			event.amplitude = velocity;
+			event.brightness = SYNTH_BRIGHTNESS(velocity);
+		}
+		else if((held & bit) != 0 && scan[n] < BEAM_CLEAR_LEVEL)
+		{
+			held &= ~bit;
+			event.type = EVENT_RELEASE;
+		}
+		else
+		{
+			// track when a string starts to be cut
+			if((held & bit) == 0)
+			{
+				if(scan[n] < BEAM_CLEAR_LEVEL)
+					rising &= ~bit;
+				else if((rising & bit) == 0)
+				{
+					rising |= bit;
+					riseStart[event.stringNo] = event.time;
+				}
+			}
+			continue;
+		}
+
+		event.fret = controls_fret(event.stringNo);
+		event_push(&event);
+	}
+
+	beam_held = held;
+}
+
+/*
+ * Pluck velocity in [BEAM_VELOCITY_MIN, 1] from the beam rise time (cycles)
+ */
+static float beam_velocity(uint32_t riseTime)
+{
+	if(riseTime <= BEAM_RISE_FAST)
+		return 1.0f;
+	if(riseTime >= BEAM_RISE_SLOW)
+		return BEAM_VELOCITY_MIN;
+	return 1.0f - (1.0f - BEAM_VELOCITY_MIN)*(float)(riseTime - BEAM_RISE_FAST)/(BEAM_RISE_SLOW - BEAM_RISE_FAST);
+}
+
+void DMA2_Stream2_IRQHandler(void)
+{
+	PROFILE_BEGIN(PROFILE_BEAM_IRQ);
+
+	if(DMA_GetITStatus(DMA2_Stream2, DMA_IT_HTIF2) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA2_Stream2, DMA_IT_HTIF2);
+		beam_scan(&scanBuffer[0]);
+	}
+
+	if(DMA_GetITStatus(DMA2_Stream2, DMA_IT_TCIF2) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA2_Stream2, DMA_IT_TCIF2);
+		beam_scan(&scanBuffer[SCAN_SIZE/2]);
+	}
+
+	PROFILE_END(PROFILE_BEAM_IRQ);
+}
@@ -0,0 +1,32 @@
+//*************************************
+//
+//  header for laser beam (string) detection
+//
+//*************************************
+
+#include <stdint.h>
+
+#ifndef __BEAM_H
+#define __BEAM_H
+
+#define BEAM_STRINGS		6
+#define BEAM_SCANS			4		// passes over all six strings per DMA half buffer (60us each)
+
+// photodiode levels (12-bit ADC, 3V): above BROKEN the beam is blocked, below CLEAR it is back
+#define BEAM_BROKEN_LEVEL	2500
+#define BEAM_CLEAR_LEVEL	1500
+
+// pluck velocity from how long the level takes to rise from CLEAR to BROKEN (a fast finger cuts the beam sooner)
+#define BEAM_RISE_FAST		(168*500)		// cycles (500us) or less: velocity 1
+#define BEAM_RISE_SLOW		(168*10000)		// cycles (10ms) or more: BEAM_VELOCITY_MIN
+#define BEAM_VELOCITY_MIN	0.2f
+
+#define BEAM_STRING_BIT(stringNo)	(1 << ((stringNo)-1))
+
+extern volatile uint32_t beam_held;		// strings whose beam is currently broken (BEAM_STRING_BIT)
+
+//function prototypes
+void beam_init(void);
+
+
+#endif /* __BEAM_H */
@@ -0,0 +1,134 @@
+//*************************************
+//
+//  on-target benchmarks
+//
+//	Only built when SYNTH_BENCHMARK is defined. main() runs them
+//	once after the cycle counter is enabled; read the results
+//	with the debugger (cycles/samples = cycles per sample).
+//	They run after audio_init, with every DMA stream going.
+//
+//*************************************
+
+#include "bench.h"
+
+#ifdef SYNTH_BENCHMARK
+
+#include "stm32f4xx.h"
+#include "ks_kernel.h"
+#include "synth.h"
+#include "notes.h"
+#include "memory.h"
+
+#define BENCH_SAMPLES	512
+#define BENCH_RUNS		8
+#define BENCH_BLOCKS	8		// synth_render blocks per run
+
+typedef void (*ks_kernel_fn)(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay);
+
+static int16_t benchLine[BENCH_SAMPLES+1];				// SRAM, shared with the DMA streams
+static int16_t benchLineCcm[BENCH_SAMPLES+1] CCM_BSS;
+static int16_t benchNoise[SYNTH_MAX_DELAY];
+static int16_t benchOut[2*SYNTH_BLOCK_FRAMES];			// SRAM, like the audio DMA buffer
+
+bench_result bench_kernel_simd;
+bench_result bench_kernel_scalar;
+bench_result bench_kernel_ccm;
+bench_result bench_kernel_flash;
+bench_result bench_kernel_sram;
+bench_result bench_render_ccm;
+bench_result bench_render_sram;
+
+/*
+ * Time one kernel over a string-sized block in line, interrupts off, best of BENCH_RUNS.
+ * The audio, beam and knob DMA streams keep running, so an SRAM line shares the bus matrix with them.
+ */
+static void bench_kernel(ks_kernel_fn kernel, int16_t line[], bench_result *result)
+{
+	uint32_t start, cycles;
+	uint16_t n;
+	uint8_t run;
+
+	result->cycles = 0xFFFFFFFF;
+	result->samples = BENCH_SAMPLES;
+
+	for(run = 0; run < BENCH_RUNS; run++)
+	{
+		for(n = 0; n <= BENCH_SAMPLES; n++)
+		{
+			line[n] = (int16_t)(n*2654435761u >> 16);
+		}
+
+		__disable_irq();
+		start = DWT->CYCCNT;
+		kernel(line, line, BENCH_SAMPLES, SYNTH_DECAY);
+		cycles = DWT->CYCCNT - start;
+		__enable_irq();
+
+		if(cycles < result->cycles)
+			result->cycles = cycles;
+	}
+}
+
+/*
+ * Time synth_render with all six strings ringing, best of BENCH_RUNS, with the voices and mix in SRAM or CCM.
+ * The interrupts stay off throughout, so the block renderer (PendSV) can't touch the voices meanwhile;
+ * the strings are silenced and the voices put back in CCM afterwards.
+ */
+static void bench_render(uint8_t sram, bench_result *result)
+{
+	uint32_t start, cycles;
+	uint16_t n;
+	uint8_t run, block, v;
+
+	result->cycles = 0xFFFFFFFF;
+	result->samples = BENCH_BLOCKS*SYNTH_BLOCK_FRAMES;
+
+	for(n = 0; n < SYNTH_MAX_DELAY; n++)
+	{
+		benchNoise[n] = (int16_t)(n*2654435761u >> 16);
+	}
+
+	__disable_irq();
+	synth_bench_sram(sram);
+	for(run = 0; run < BENCH_RUNS; run++)
+	{
+		for(v = 0; v < SYNTH_VOICES; v++)
+		{
+			synth_pluck(v, benchNoise, notes_lookup(TUNING_STANDARD, v+1, 0), 1.0f, SYNTH_BRIGHTNESS(1.0f),
+					BENCH_BLOCKS*SYNTH_BLOCK_FRAMES);
+		}
+
+		start = DWT->CYCCNT;
+		for(block = 0; block < BENCH_BLOCKS; block++)
+		{
+			synth_render(benchOut, SYNTH_BLOCK_FRAMES);
+		}
+		cycles = DWT->CYCCNT - start;
+
+		if(cycles < result->cycles)
+			result->cycles = cycles;
+	}
+	synth_bench_sram(0);
+	for(v = 0; v < SYNTH_VOICES; v++)
+	{
+		synth_pluck(v, benchNoise, notes_lookup(TUNING_STANDARD, v+1, 0), 0, SYNTH_BRIGHTNESS(1.0f), 0);
+	}
+	__enable_irq();
+}
+
+void bench_run(void)
+{
+	bench_kernel(ks_kernel_block, benchLine, &bench_kernel_simd);
+	bench_kernel(ks_kernel_block_scalar, benchLine, &bench_kernel_scalar);
+	bench_kernel(ks_kernel_block, benchLineCcm, &bench_kernel_ccm);
+
+	// code placement, with the data in CCM so only instruction fetches differ
+	bench_kernel(ks_kernel_block_flash, benchLineCcm, &bench_kernel_flash);
+	bench_kernel(ks_kernel_block_sram, benchLineCcm, &bench_kernel_sram);
+
+	// data placement for the whole render
+	bench_render(0, &bench_render_ccm);
+	bench_render(1, &bench_render_sram);
+}
+
+#endif /* SYNTH_BENCHMARK */
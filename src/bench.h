@@ -0,0 +1,30 @@
+//*************************************
+//
+//  header for on-target benchmarks
+//
+//*************************************
+
+#include <stdint.h>
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+typedef struct
+{
+	uint32_t cycles;		// best of BENCH_RUNS
+	uint32_t samples;		// samples processed per run
+} bench_result;
+
+extern bench_result bench_kernel_simd;
+extern bench_result bench_kernel_scalar;
+extern bench_result bench_kernel_ccm;		// bench_kernel_simd with the line in CCM instead of SRAM
+extern bench_result bench_kernel_flash;		// SIMD kernel run from flash (ART), line in CCM
+extern bench_result bench_kernel_sram;		// SIMD kernel run from SRAM, line in CCM
+extern bench_result bench_render_ccm;		// synth_render with six strings ringing, voices and mix in CCM (samples = frames)
+extern bench_result bench_render_sram;		// the same with the voices and mix in SRAM
+
+//function prototypes
+void bench_run(void);
+
+
+#endif /* __BENCH_H */
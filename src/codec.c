@@ -5,10 +5,40 @@
 //	adapted from A.Finkelmeyer
 //  http://www.mind-dump.net/configuring-the-stm32f4-discovery-for-audio
 //
+//	Start-up configures the codec with blocking transfers
+//	(send_codec_ctrl, read_codec_register); every wait on the
+//	bus is bounded by CODEC_TIMEOUT, so a missing or hung codec
+//	costs boot a few milliseconds instead of hanging it.
+//	At run time register writes go through a command queue
+//	(codec_write): the I2C1 event interrupt moves each command
+//	over the bus a byte at a time and calls its callback when
+//	it is done, so the audio loop only pays for copying a few
+//	bytes. codec_poll() starts the next command once the bus is
+//	free and fails any command that has been at the front of the
+//	queue for longer than CODEC_TIMEOUT, resetting the I2C block
+//	in case the bus is stuck.
+//
 //*************************************
 
 #include "codec.h"
 
+#define QUEUE_MASK		(CODEC_QUEUE_SIZE-1)
+
+static codec_command queue[CODEC_QUEUE_SIZE];
+static uint32_t head = 0;					// commands queued (codec_write only)
+static uint32_t tail = 0;					// commands finished (interrupt, or codec_poll with the interrupts off)
+static volatile uint8_t active = 0;			// command queue[tail] is on the bus
+static uint8_t sent = 0;					// bytes of the active command written to the bus
+static volatile uint32_t frontTime = 0;		// cycle count when queue[tail] reached the front of the queue
+volatile uint32_t codec_errors = 0;			// commands/transfers that failed or timed out
+
+static void i2c_config(void);
+static void i2c_recover(void);
+static uint8_t wait_flag(uint32_t flag, FlagStatus state);
+static uint8_t wait_event(uint32_t event);
+static void command_finish(uint8_t status);
+static void wait_us(uint32_t start, uint32_t us);
+
 void codec_init()
 {
 	// enable GPIOA, GPIOB, GPIOC, GPIOD clocks
@@ -16,6 +46,10 @@ void codec_init()
 
 	//enable I2S and I2C clocks
 	RCC_APB1PeriphClockCmd(RCC_APB1Periph_I2C1 | RCC_APB1Periph_SPI3, ENABLE);
+
+	// PLLI2S = 1MHz*258/3 = 86MHz gives 47.991kHz frames for a 48kHz request
+	// (reset value 192/2 = 96MHz only reaches 46.875kHz); synth.h tunes to this rate
+	RCC_PLLI2SConfig(258, 3);
 	RCC_PLLI2SCmd(ENABLE);
 
 	// setting up GPIO for codec use
@@ -72,10 +106,32 @@ void codec_init()
 	I2S_Init(CODEC_I2S, &I2S_InitType);
 
 
-	I2C_InitTypeDef I2C_InitType;
-
 	// configure I2C port
 	I2C_DeInit(CODEC_I2C);
+	i2c_config();
+
+	// the command queue's interrupts are switched on per command in the I2C block (see codec_poll),
+	// so the blocking start-up transfers never see them
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	// below the strings and the knobs: a register write can always wait a few microseconds
+	NVIC_InitStructure.NVIC_IRQChannel = I2C1_EV_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 14;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	NVIC_InitStructure.NVIC_IRQChannel = I2C1_ER_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+}
+
+/*
+ * I2C1 as a 100kHz master
+ */
+static void i2c_config(void)
+{
+	I2C_InitTypeDef I2C_InitType;
+
 	I2C_InitType.I2C_ClockSpeed = 100000;
 	I2C_InitType.I2C_Mode = I2C_Mode_I2C;
 	I2C_InitType.I2C_OwnAddress1 = CORE_I2C_ADDRESS;
@@ -87,20 +143,79 @@ void codec_init()
 	I2C_Init(CODEC_I2C, &I2C_InitType);
 }
 
+/*
+ * Wait until us microseconds after the cycle count start
+ */
+static void wait_us(uint32_t start, uint32_t us)
+{
+	while(DWT->CYCCNT - start < us*CODEC_CYCLES_PER_US)
+	{
+		//wait
+	}
+}
+
+/*
+ * Reset the I2C block after a transfer got stuck (lost arbitration, codec holding the bus, missed interrupt)
+ */
+static void i2c_recover(void)
+{
+	I2C_ITConfig(CODEC_I2C, I2C_IT_EVT | I2C_IT_ERR, DISABLE);
+	I2C_SoftwareResetCmd(CODEC_I2C, ENABLE);
+	I2C_SoftwareResetCmd(CODEC_I2C, DISABLE);
+	i2c_config();
+	codec_errors++;
+}
+
+/*
+ * Wait (bounded) for an I2C status flag; after a timeout the I2C block is reset
+ */
+static uint8_t wait_flag(uint32_t flag, FlagStatus state)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	while(I2C_GetFlagStatus(CODEC_I2C, flag) != state)
+	{
+		if(DWT->CYCCNT - start > CODEC_TIMEOUT)
+		{
+			i2c_recover();
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * Wait (bounded) for an I2C event; after a timeout the I2C block is reset
+ */
+static uint8_t wait_event(uint32_t event)
+{
+	uint32_t start = DWT->CYCCNT;
+
+	while(I2C_CheckEvent(CODEC_I2C, event) != SUCCESS)
+	{
+		if(DWT->CYCCNT - start > CODEC_TIMEOUT)
+		{
+			i2c_recover();
+			return 0;
+		}
+	}
+	return 1;
+}
 
+
+/*
+ * Take the codec out of reset and configure it. Anything that doesn't need the codec
+ * can be set up between codec_init and this; there is no minimum reset time to wait out.
+ */
 void codec_ctrl_init()
 {
-	uint32_t delaycount;
 	uint8_t CodecCommandBuffer[5];
 
 	uint8_t regValue = 0xFF;
 
 	GPIO_SetBits(GPIOD, CODEC_RESET_PIN);
-	delaycount = 1000000;
-	while (delaycount > 0)
-	{
-		delaycount--;
-	}
+	wait_us(DWT->CYCCNT, CODEC_RESET_START_US);
+
 	//keep codec OFF
 	CodecCommandBuffer[0] = CODEC_MAP_PLAYBACK_CTRL1;
 	CodecCommandBuffer[1] = 0x01;
@@ -172,97 +287,251 @@ void codec_ctrl_init()
 	I2S_Cmd(CODEC_I2S, ENABLE);
 }
 
-void send_codec_ctrl(uint8_t controlBytes[], uint8_t numBytes)
+/*
+ * Blocking register write for start-up (before codec_write is used); returns 0 if the transfer failed
+ */
+uint8_t send_codec_ctrl(uint8_t controlBytes[], uint8_t numBytes)
 {
 	uint8_t bytesSent=0;
 
-	while (I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_BUSY))
-	{
-		//just wait until no longer busy
-	}
+	//wait until no longer busy
+	if(!wait_flag(I2C_FLAG_BUSY, RESET))
+		return 0;
 
 	I2C_GenerateSTART(CODEC_I2C, ENABLE);
-	while (!I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_SB))
-	{
-		//wait for generation of start condition
-	}
+	//wait for generation of start condition
+	if(!wait_flag(I2C_FLAG_SB, SET))
+		return 0;
+
 	I2C_Send7bitAddress(CODEC_I2C, CODEC_I2C_ADDRESS, I2C_Direction_Transmitter);
-	while (!I2C_CheckEvent(CODEC_I2C, I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED))
-	{
-		//wait for end of address transmission
-	}
+	//wait for end of address transmission
+	if(!wait_event(I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED))
+		return 0;
+
 	while (bytesSent < numBytes)
 	{
 		I2C_SendData(CODEC_I2C, controlBytes[bytesSent]);
 		bytesSent++;
-		while (!I2C_CheckEvent(CODEC_I2C, I2C_EVENT_MASTER_BYTE_TRANSMITTING))
-		{
-			//wait for transmission of byte
-		}
-	}
-	while(!I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_BTF))
-	{
-	    //wait until it's finished sending before creating STOP
+		//wait for transmission of byte
+		if(!wait_event(I2C_EVENT_MASTER_BYTE_TRANSMITTING))
+			return 0;
 	}
-	I2C_GenerateSTOP(CODEC_I2C, ENABLE);
+	//wait until it's finished sending before creating STOP
+	if(!wait_flag(I2C_FLAG_BTF, SET))
+		return 0;
 
+	I2C_GenerateSTOP(CODEC_I2C, ENABLE);
+	return 1;
 }
 
+/*
+ * Blocking register read for start-up (before codec_write is used); returns 0 if the transfer failed
+ */
 uint8_t read_codec_register(uint8_t mapbyte)
 {
 	uint8_t receivedByte = 0;
 
-	while (I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_BUSY))
-	{
-		//just wait until no longer busy
-	}
+	//wait until no longer busy
+	if(!wait_flag(I2C_FLAG_BUSY, RESET))
+		return 0;
 
 	I2C_GenerateSTART(CODEC_I2C, ENABLE);
-	while (!I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_SB))
-	{
-		//wait for generation of start condition
-	}
+	//wait for generation of start condition
+	if(!wait_flag(I2C_FLAG_SB, SET))
+		return 0;
 
 	I2C_Send7bitAddress(CODEC_I2C, CODEC_I2C_ADDRESS, I2C_Direction_Transmitter);
-	while (!I2C_CheckEvent(CODEC_I2C, I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED))
-	{
-		//wait for end of address transmission
-	}
+	//wait for end of address transmission
+	if(!wait_event(I2C_EVENT_MASTER_TRANSMITTER_MODE_SELECTED))
+		return 0;
 
 	I2C_SendData(CODEC_I2C, mapbyte); //sets the transmitter address
-	while (!I2C_CheckEvent(CODEC_I2C, I2C_EVENT_MASTER_BYTE_TRANSMITTING))
+	//wait for transmission of byte
+	if(!wait_event(I2C_EVENT_MASTER_BYTE_TRANSMITTING))
+		return 0;
+
+	I2C_GenerateSTOP(CODEC_I2C, ENABLE);
+
+	//wait until no longer busy
+	if(!wait_flag(I2C_FLAG_BUSY, RESET))
+		return 0;
+
+	I2C_AcknowledgeConfig(CODEC_I2C, DISABLE);
+
+	I2C_GenerateSTART(CODEC_I2C, ENABLE);
+	//wait for generation of start condition
+	if(!wait_flag(I2C_FLAG_SB, SET))
+		return 0;
+
+	I2C_Send7bitAddress(CODEC_I2C, CODEC_I2C_ADDRESS, I2C_Direction_Receiver);
+	//wait for end of address transmission
+	if(!wait_event(I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED))
+		return 0;
+
+	//wait until byte arrived
+	if(!wait_event(I2C_EVENT_MASTER_BYTE_RECEIVED))
+		return 0;
+	receivedByte = I2C_ReceiveData(CODEC_I2C);
+
+	I2C_GenerateSTOP(CODEC_I2C, ENABLE);
+
+	return receivedByte;
+}
+
+/*
+ * Queue a register write (map byte first, at most CODEC_COMMAND_BYTES) without waiting for the bus.
+ * done (may be 0) is called from the I2C interrupt, or from codec_poll on a timeout, with CODEC_OK,
+ * CODEC_FAILED or CODEC_TIMEOUT_EXPIRED. Returns 0 if the queue is full.
+ * Main loop only.
+ */
+uint8_t codec_write(const uint8_t controlBytes[], uint8_t numBytes, codec_callback done)
+{
+	codec_command *command;
+	uint8_t i;
+
+	if(numBytes == 0 || numBytes > CODEC_COMMAND_BYTES || head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= CODEC_QUEUE_SIZE)
+		return 0;
+
+	command = &queue[head & QUEUE_MASK];
+	for(i = 0; i < numBytes; i++)
 	{
-		//wait for transmission of byte
+		command->bytes[i] = controlBytes[i];
 	}
+	command->length = numBytes;
+	command->done = done;
 
-	I2C_GenerateSTOP(CODEC_I2C, ENABLE);
+	// an empty queue starts the timeout for this command now
+	if(head == __atomic_load_n(&tail, __ATOMIC_ACQUIRE))
+		frontTime = DWT->CYCCNT;
+	__atomic_store_n(&head, head+1, __ATOMIC_RELEASE);
+
+	codec_poll();
+	return 1;
+}
 
-	while (I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_BUSY))
+/*
+ * Start the next queued command once the bus is free, and fail a command that is overdue.
+ * Called from the main loop (every pass is fine, it costs a few register reads).
+ */
+void codec_poll(void)
+{
+	if(__atomic_load_n(&tail, __ATOMIC_ACQUIRE) == head)
+		return;
+
+	if(DWT->CYCCNT - frontTime > CODEC_TIMEOUT)
 	{
-		//just wait until no longer busy
+		// keep the interrupt from finishing the same command
+		NVIC_DisableIRQ(I2C1_EV_IRQn);
+		NVIC_DisableIRQ(I2C1_ER_IRQn);
+		if(tail != head && DWT->CYCCNT - frontTime > CODEC_TIMEOUT)
+		{
+			i2c_recover();
+			command_finish(CODEC_TIMEOUT_EXPIRED);
+		}
+		NVIC_EnableIRQ(I2C1_EV_IRQn);
+		NVIC_EnableIRQ(I2C1_ER_IRQn);
+		return;
 	}
 
-	I2C_AcknowledgeConfig(CODEC_I2C, DISABLE);
+	// the previous STOP has to be on the bus before the next START
+	if(active || (CODEC_I2C->CR1 & I2C_CR1_STOP) || I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_BUSY))
+		return;
 
+	sent = 0;
+	active = 1;
+	I2C_ITConfig(CODEC_I2C, I2C_IT_EVT | I2C_IT_ERR, ENABLE);
 	I2C_GenerateSTART(CODEC_I2C, ENABLE);
-	while (!I2C_GetFlagStatus(CODEC_I2C, I2C_FLAG_SB))
+}
+
+/*
+ * Retire the command at the front of the queue (interrupt, or codec_poll with the interrupts off)
+ */
+static void command_finish(uint8_t status)
+{
+	codec_callback done = queue[tail & QUEUE_MASK].done;
+
+	I2C_ITConfig(CODEC_I2C, I2C_IT_EVT | I2C_IT_ERR, DISABLE);
+	active = 0;
+	frontTime = DWT->CYCCNT;
+	__atomic_store_n(&tail, tail+1, __ATOMIC_RELEASE);
+
+	if(status != CODEC_OK)
+		codec_errors++;
+	if(done != 0)
+		done(status);
+}
+
+/*
+ * Command queue transfer: start bit -> address -> one byte per BTF -> STOP.
+ * Only EVT is enabled (no TXE), so there is one interrupt per byte.
+ */
+void I2C1_EV_IRQHandler(void)
+{
+	codec_command *command = &queue[tail & QUEUE_MASK];
+	uint32_t event = I2C_GetLastEvent(CODEC_I2C);	// reads SR1 then SR2, which also clears ADDR
+
+	if(!active)
 	{
-		//wait for generation of start condition
+		I2C_ITConfig(CODEC_I2C, I2C_IT_EVT | I2C_IT_ERR, DISABLE);
+		return;
 	}
 
-	I2C_Send7bitAddress(CODEC_I2C, CODEC_I2C_ADDRESS, I2C_Direction_Receiver);
-	while (!I2C_CheckEvent(CODEC_I2C, I2C_EVENT_MASTER_RECEIVER_MODE_SELECTED))
+	if(event & I2C_SR1_SB)
 	{
-		//wait for end of address transmission
+		I2C_Send7bitAddress(CODEC_I2C, CODEC_I2C_ADDRESS, I2C_Direction_Transmitter);
 	}
+	else if(event & (I2C_SR1_ADDR | I2C_SR1_BTF))
+	{
+		if(sent < command->length)
+		{
+			I2C_SendData(CODEC_I2C, command->bytes[sent]);
+			sent++;
+		}
+		else
+		{
+			I2C_GenerateSTOP(CODEC_I2C, ENABLE);
+			command_finish(CODEC_OK);
+		}
+	}
+}
 
-	while (!I2C_CheckEvent(CODEC_I2C, I2C_EVENT_MASTER_BYTE_RECEIVED))
+/*
+ * Codec didn't acknowledge, bus error or lost arbitration: drop the command
+ */
+void I2C1_ER_IRQHandler(void)
+{
+	if(I2C_GetITStatus(CODEC_I2C, I2C_IT_AF) != RESET)
 	{
-		//wait until byte arrived
+		I2C_GenerateSTOP(CODEC_I2C, ENABLE);
 	}
-	receivedByte = I2C_ReceiveData(CODEC_I2C);
+	I2C_ClearITPendingBit(CODEC_I2C, I2C_IT_AF | I2C_IT_BERR | I2C_IT_ARLO | I2C_IT_OVR);
 
-	I2C_GenerateSTOP(CODEC_I2C, ENABLE);
+	if(active)
+	{
+		command_finish(CODEC_FAILED);
+	}
+	else
+	{
+		I2C_ITConfig(CODEC_I2C, I2C_IT_EVT | I2C_IT_ERR, DISABLE);
+	}
+}
 
-	return receivedByte;
+/*
+ * Queue a master volume change of both channels in 0.5dB steps (CODEC_VOLUME_MIN to CODEC_VOLUME_MAX);
+ * done is called once it is written (see codec_write). Returns 0 if the queue is full.
+ */
+uint8_t codec_set_volume(int16_t halfdB, codec_callback done)
+{
+	uint8_t CodecCommandBuffer[3];
+
+	if(halfdB < CODEC_VOLUME_MIN)
+		halfdB = CODEC_VOLUME_MIN;
+	else if(halfdB > CODEC_VOLUME_MAX)
+		halfdB = CODEC_VOLUME_MAX;
+
+	// registers hold the two's complement step count (0x00 = 0dB, 0x34 = -102dB)
+	CodecCommandBuffer[0] = CODEC_MAP_MASTER_A_VOL | CODEC_MAPBYTE_INC;
+	CodecCommandBuffer[1] = (uint8_t)halfdB;
+	CodecCommandBuffer[2] = (uint8_t)halfdB;
+	return codec_write(CodecCommandBuffer, 3, done);
 }
@@ -41,12 +41,47 @@
 #define CODEC_MAP_CLK_CTRL  0x05
 #define CODEC_MAP_IF_CTRL1  0x06
 #define CODEC_MAP_PLAYBACK_CTRL1 0x0D
+#define CODEC_MAP_MASTER_A_VOL 0x20
+#define CODEC_MAP_MASTER_B_VOL 0x21
+
+//master volume range in 0.5dB steps
+#define CODEC_VOLUME_MIN	(-204)	// -102dB
+#define CODEC_VOLUME_MAX	0		// 0dB (the register goes to +12dB, which would clip a full scale signal)
+
+//start-up timing: RESET is held low from codec_init to codec_ctrl_init, while the rest of the board is set up.
+//The datasheet gives no minimum RESET low time, only that the supplies are stable first (they are by main).
+#define CODEC_CYCLES_PER_US		168				// DWT->CYCCNT counts core clock cycles
+#define CODEC_RESET_START_US	1				// RESET high to the first control port START (datasheet: 550ns)
+
+//control channel
+#define CODEC_QUEUE_SIZE	8				// queued register writes (power of 2)
+#define CODEC_COMMAND_BYTES	4				// map byte + up to 3 data bytes per write
+#define CODEC_TIMEOUT		(168000000/500)	// 2ms in core cycles for any one transfer (a 3 byte write takes 0.4ms at 100kHz)
+
+//command results passed to codec_callback
+#define CODEC_OK			0
+#define CODEC_FAILED		1				// not acknowledged, bus error or lost arbitration
+#define CODEC_TIMEOUT_EXPIRED	2			// not finished within CODEC_TIMEOUT (the I2C block was reset)
+
+typedef void (*codec_callback)(uint8_t status);
+
+typedef struct
+{
+	uint8_t bytes[CODEC_COMMAND_BYTES];		// map byte, then data
+	uint8_t length;
+	codec_callback done;					// called when the write has finished or failed (may be 0)
+} codec_command;
+
+extern volatile uint32_t codec_errors;
 
 //function prototypes
 void codec_init();
 void codec_ctrl_init();
-void send_codec_ctrl(uint8_t controlBytes[], uint8_t numBytes);
+uint8_t send_codec_ctrl(uint8_t controlBytes[], uint8_t numBytes);
 uint8_t read_codec_register(uint8_t mapByte);
+uint8_t codec_write(const uint8_t controlBytes[], uint8_t numBytes, codec_callback done);
+void codec_poll(void);
+uint8_t codec_set_volume(int16_t halfdB, codec_callback done);
 
 
 #endif /* __CODEC_H */
@@ -0,0 +1,236 @@
+//*************************************
+//
+//  volume knob and fret buttons
+//
+//	TIM2 triggers one ADC1 scan of the volume knob and the six
+//	fret button ladders every 500us (2kHz); DMA2 stream 4 stores
+//	the scans in a circular buffer. The F4 ADC has no hardware
+//	oversampler, so each half of the buffer (CONTROLS_OVERSAMPLE
+//	scans) is summed in its interrupt: 16 12-bit readings add up
+//	to one 16-bit value (the scale notes_fret() thresholds are
+//	on) with a quarter of the noise, refreshed every 8ms.
+//	A fret only changes when the new value is clear of every
+//	threshold by FRET_HYSTERESIS, so a reading sitting on a
+//	threshold can't flip between two frets, and each change is
+//	queued as an EVENT_FRET (see event.c).
+//	The volume knob sets the codec master volume (main.c), so it
+//	is kept in 0.5dB steps with the same kind of dead band.
+//	Reading a control (also from an interrupt) is a memory load.
+//
+//*************************************
+
+#include "controls.h"
+#include "notes.h"
+#include "event.h"
+#include "profile.h"
+#include "codec.h"
+
+#define CONTROLS_CHANNELS		7
+#define CONTROLS_OVERSAMPLE		16		// scans summed per value (16 x 12 bits = 16 bits)
+#define SCAN_SIZE				(2*CONTROLS_OVERSAMPLE*CONTROLS_CHANNELS)
+#define FRET_HYSTERESIS			512		// 16-bit counts either side of a fret threshold
+#define VOLUME_HYSTERESIS		1		// 0.5dB steps the knob must move past before the volume follows
+
+uint16_t ADC1_val[CONTROLS_CHANNELS];		// volume knob and fret buttons voltage (16-bit sums, only used by the ISR)
+
+// ADC1_val[] entry holding each string's fret buttons
+static const uint8_t stringFretADC[7] = {0, 6, 5, 4, 3, 2, 1};
+
+static uint16_t scanBuffer[SCAN_SIZE];
+static volatile uint8_t frets[7];		// fret held on each string (index 1-6)
+static volatile int16_t volume = CODEC_VOLUME_MIN;	// master volume (0.5dB steps)
+
+static void controls_scan(const uint16_t scan[]);
+static uint8_t fret_filter(uint16_t value, uint8_t current);
+
+/*
+ * Fret held on a string (0 = open)
+ */
+uint8_t controls_fret(uint8_t stringNo)
+{
+	return frets[stringNo];
+}
+
+/*
+ * Volume knob position as a codec master volume (0.5dB steps, CODEC_VOLUME_MIN to CODEC_VOLUME_MAX)
+ */
+int16_t controls_volume(void)
+{
+	return volume;
+}
+
+/*
+ * Start the timer paced ADC1 scan (also sets the ADC clock shared with ADC2, see beam.c)
+ */
+void controls_init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStructure;
+	ADC_InitTypeDef ADC_InitStruct;
+	ADC_CommonInitTypeDef ADC_CommonInitStruct;
+	DMA_InitTypeDef DMA_InitStruct;
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA|RCC_AHB1Periph_GPIOB|RCC_AHB1Periph_GPIOC|RCC_AHB1Periph_DMA2, ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1, ENABLE);
+
+	/* Volume knob: PA2. Fret buttons: PA3, PB0, PC1, PC2, PC4, PC5 */
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AN;
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_2 | GPIO_Pin_3;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+
+	GPIO_Init(GPIOA, &GPIO_InitStructure);
+
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AN;
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+
+	GPIO_Init(GPIOB, &GPIO_InitStructure);
+
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AN;
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_1 | GPIO_Pin_2 | GPIO_Pin_4 | GPIO_Pin_5;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+
+	GPIO_Init(GPIOC, &GPIO_InitStructure);
+
+	DMA_InitStruct.DMA_BufferSize = SCAN_SIZE;
+	DMA_InitStruct.DMA_Channel = DMA_Channel_0;
+	DMA_InitStruct.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStruct.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStruct.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStruct.DMA_Memory0BaseAddr = (uint32_t)scanBuffer;
+	DMA_InitStruct.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStruct.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	DMA_InitStruct.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStruct.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStruct.DMA_PeripheralBaseAddr = (uint32_t) &ADC1->DR;
+	DMA_InitStruct.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_InitStruct.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	DMA_InitStruct.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStruct.DMA_Priority = DMA_Priority_High;
+	DMA_Init(DMA2_Stream4, &DMA_InitStruct);
+	DMA_ITConfig(DMA2_Stream4, DMA_IT_HT | DMA_IT_TC, ENABLE);
+	DMA_Cmd(DMA2_Stream4, ENABLE);
+
+	ADC_CommonInitStruct.ADC_DMAAccessMode = ADC_DMAAccessMode_Disabled;
+	ADC_CommonInitStruct.ADC_Mode = ADC_Mode_Independent;
+	ADC_CommonInitStruct.ADC_Prescaler = ADC_Prescaler_Div2;
+	ADC_CommonInitStruct.ADC_TwoSamplingDelay = ADC_TwoSamplingDelay_5Cycles;
+	ADC_CommonInit(&ADC_CommonInitStruct);
+
+	// one scan of all 7 channels per TIM2 update
+	ADC_InitStruct.ADC_ContinuousConvMode = DISABLE;
+	ADC_InitStruct.ADC_DataAlign = ADC_DataAlign_Right;
+	ADC_InitStruct.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
+	ADC_InitStruct.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T2_TRGO;
+	ADC_InitStruct.ADC_NbrOfConversion = CONTROLS_CHANNELS;
+	ADC_InitStruct.ADC_Resolution = ADC_Resolution_12b;
+	ADC_InitStruct.ADC_ScanConvMode = ENABLE;
+	ADC_Init(ADC1, &ADC_InitStruct);
+
+	ADC_RegularChannelConfig(ADC1, ADC_Channel_2, 1, ADC_SampleTime_112Cycles); //PA2
+	ADC_RegularChannelConfig(ADC1, ADC_Channel_3, 2, ADC_SampleTime_112Cycles); //PA3
+	ADC_RegularChannelConfig(ADC1, ADC_Channel_8, 3, ADC_SampleTime_112Cycles); //PB0
+	ADC_RegularChannelConfig(ADC1, ADC_Channel_11, 4, ADC_SampleTime_112Cycles); //PC1
+	ADC_RegularChannelConfig(ADC1, ADC_Channel_12, 5, ADC_SampleTime_112Cycles); //PC2
+	ADC_RegularChannelConfig(ADC1, ADC_Channel_14, 6, ADC_SampleTime_112Cycles); //PC4
+	ADC_RegularChannelConfig(ADC1, ADC_Channel_15, 7, ADC_SampleTime_112Cycles); //PC5
+
+	ADC_DMARequestAfterLastTransferCmd(ADC1, ENABLE);
+	ADC_DMACmd(ADC1, ENABLE);
+	ADC_Cmd(ADC1, ENABLE);
+
+	// same preemption priority as the beam interrupt: both push to the event queue, which allows one producer
+	NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream4_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	// TIM2: 2kHz scan trigger (84MHz timer clock / 84 / 500)
+	TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+	TIM_TimeBaseStructure.TIM_Period = 500-1;
+	TIM_TimeBaseStructure.TIM_Prescaler = 84-1;
+	TIM_TimeBaseStructure.TIM_ClockDivision = 0;
+	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(TIM2, &TIM_TimeBaseStructure);
+	TIM_SelectOutputTrigger(TIM2, TIM_TRGOSource_Update);
+	TIM_Cmd(TIM2, ENABLE);
+}
+
+/*
+ * New fret for a reading, or the current one while the reading is within FRET_HYSTERESIS of a threshold
+ */
+static uint8_t fret_filter(uint16_t value, uint8_t current)
+{
+	uint8_t fret = notes_fret(value);
+	uint16_t low = (value > FRET_HYSTERESIS) ? value - FRET_HYSTERESIS : 0;
+	uint16_t high = (value < 0xFFFF - FRET_HYSTERESIS) ? value + FRET_HYSTERESIS : 0xFFFF;
+
+	if(notes_fret(low) != fret || notes_fret(high) != fret)
+		return current;
+	return fret;
+}
+
+/*
+ * Sum one half of scanBuffer into ADC1_val and report fret changes
+ */
+static void controls_scan(const uint16_t scan[])
+{
+	uint32_t sum[CONTROLS_CHANNELS] = {0};
+	string_event event;
+	uint8_t n, c, fret;
+	int32_t level;
+
+	for(n = 0; n < CONTROLS_OVERSAMPLE; n++)
+	{
+		for(c = 0; c < CONTROLS_CHANNELS; c++)
+		{
+			sum[c] += scan[n*CONTROLS_CHANNELS + c];
+		}
+	}
+	for(c = 0; c < CONTROLS_CHANNELS; c++)
+	{
+		ADC1_val[c] = (uint16_t)sum[c];
+	}
+
+	// knob travel is linear in dB (audio taper); ignore a single step of jitter
+	level = CODEC_VOLUME_MIN + (int32_t)ADC1_val[0]*(CODEC_VOLUME_MAX - CODEC_VOLUME_MIN)/(CONTROLS_OVERSAMPLE*4095);
+	if(level > volume + VOLUME_HYSTERESIS || level < volume - VOLUME_HYSTERESIS)
+		volume = (int16_t)level;
+
+	event.type = EVENT_FRET;
+	event.time = DWT->CYCCNT;
+	event.amplitude = 0;
+	event.brightness = 0;
+	for(event.stringNo = 1; event.stringNo <= 6; event.stringNo++)
+	{
+		fret = fret_filter(ADC1_val[stringFretADC[event.stringNo]], frets[event.stringNo]);
+		if(fret != frets[event.stringNo])
+		{
+			frets[event.stringNo] = fret;
+			event.fret = fret;
+			event_push(&event);
+		}
+	}
+}
+
+void DMA2_Stream4_IRQHandler(void)
+{
+	PROFILE_BEGIN(PROFILE_CONTROLS_IRQ);
+
+	if(DMA_GetITStatus(DMA2_Stream4, DMA_IT_HTIF4) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA2_Stream4, DMA_IT_HTIF4);
+		controls_scan(&scanBuffer[0]);
+	}
+
+	if(DMA_GetITStatus(DMA2_Stream4, DMA_IT_TCIF4) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA2_Stream4, DMA_IT_TCIF4);
+		controls_scan(&scanBuffer[SCAN_SIZE/2]);
+	}
+
+	PROFILE_END(PROFILE_CONTROLS_IRQ);
+}
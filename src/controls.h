@@ -0,0 +1,21 @@
+//*************************************
+//
+//  header for the volume knob and fret buttons
+//
+//*************************************
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+#ifndef __CONTROLS_H
+#define __CONTROLS_H
+
+extern uint16_t ADC1_val[7];
+
+//function prototypes
+void controls_init(void);
+uint8_t controls_fret(uint8_t stringNo);
+int16_t controls_volume(void);
+
+
+#endif /* __CONTROLS_H */
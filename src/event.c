@@ -0,0 +1,59 @@
+//*************************************
+//
+//  string event queue
+//
+//	Wait-free single producer/single consumer ring: the beam
+//	detection and fret scan interrupts push, the block renderer
+//	(PendSV) pops.
+//	The producers run at the same preemption priority, so they
+//	never interrupt each other and act as one producer. Each side
+//	only ever writes its own index (head for the producer, tail
+//	for the consumer), and the index is published with release
+//	ordering after the slot is written or read, so neither side
+//	needs to disable interrupts and no event is torn or lost
+//	while there is room. When the ring is full the new event is
+//	dropped and counted in event_dropped.
+//
+//*************************************
+
+#include "event.h"
+
+#define QUEUE_MASK	(EVENT_QUEUE_SIZE-1)
+
+static string_event queue[EVENT_QUEUE_SIZE];
+static uint32_t head = 0;				// next slot to write (producer only)
+static uint32_t tail = 0;				// next slot to read (consumer only)
+volatile uint32_t event_dropped = 0;	// events lost because the queue was full
+
+/*
+ * Add an event (producer side only). Returns 0 if the queue was full.
+ */
+uint8_t event_push(const string_event *e)
+{
+	uint32_t h = head;
+
+	if(h - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) == EVENT_QUEUE_SIZE)
+	{
+		event_dropped++;
+		return 0;
+	}
+
+	queue[h & QUEUE_MASK] = *e;
+	__atomic_store_n(&head, h+1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/*
+ * Take the oldest event (consumer side only). Returns 0 if the queue was empty.
+ */
+uint8_t event_pop(string_event *e)
+{
+	uint32_t t = tail;
+
+	if(__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t)
+		return 0;
+
+	*e = queue[t & QUEUE_MASK];
+	__atomic_store_n(&tail, t+1, __ATOMIC_RELEASE);
+	return 1;
+}
@@ -0,0 +1,41 @@
+//*************************************
+//
+//  header for the string event queue
+//
+//	No hardware access, so it also builds on the host.
+//
+//*************************************
+
+#include <stdint.h>
+
+#ifndef __EVENT_H
+#define __EVENT_H
+
+#define EVENT_QUEUE_SIZE	16		// power of 2; a six string strum plus releases fits
+#define EVENT_CLOCK_HZ		168000000	// event times count core clock cycles (DWT->CYCCNT)
+
+typedef enum
+{
+	EVENT_ONSET = 0,			// beam broken: pluck
+	EVENT_RELEASE,				// beam back
+	EVENT_FRET					// fret held on a string changed (amplitude and brightness unused)
+} event_type;
+
+typedef struct
+{
+	uint32_t time;				// DWT cycle count (core clock) when the beam or fret changed
+	uint8_t type;				// event_type
+	uint8_t stringNo;			// 1-6
+	uint8_t fret;				// fret held on that string at the time (0 = open)
+	float amplitude;			// note amplitude (pluck velocity; the volume knob is applied by the codec)
+	uint16_t brightness;		// excitation lowpass for the pluck velocity (SYNTH_BRIGHTNESS)
+} string_event;
+
+extern volatile uint32_t event_dropped;
+
+//function prototypes
+uint8_t event_push(const string_event *e);
+uint8_t event_pop(string_event *e);
+
+
+#endif /* __EVENT_H */
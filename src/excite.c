@@ -0,0 +1,125 @@
+//*************************************
+//
+//  pluck excitation pool
+//
+//	Every pluck starts its string with a fresh burst of white
+//	noise (SYNTH_MAX_DELAY samples), so repeating a note doesn't
+//	repeat the same sound. The hardware RNG interrupt keeps a
+//	ring of EXCITE_BLOCKS bursts filled, two samples per random
+//	word, and switches itself off once all but the block being
+//	handed out are full; taking a block switches it back on.
+//	Filling one block takes about 350 interrupts (roughly 0.5ms),
+//	so boot doesn't wait for it and plucks never poll the RNG.
+//	If plucks outrun the RNG the last burst is reused. Until the
+//	RNG has filled a block that is a burst from a small PRNG, so
+//	a pluck right after boot still sounds.
+//
+//*************************************
+
+#include "excite.h"
+#include "stm32f4xx.h"
+#include "memory.h"
+
+#define BLOCK_WORDS		(SYNTH_MAX_DELAY/2)
+#define SEED			0x2545F491	// any nonzero xorshift state
+
+static int16_t pool[EXCITE_BLOCKS][SYNTH_MAX_DELAY] CCM_BSS;		// filled by the core, not DMA
+static uint32_t head = 0;					// blocks filled (interrupt only)
+static uint32_t tail = 0;					// blocks taken (excite_take only)
+static uint16_t fillWord = 0;				// next word of block head being filled
+static const int16_t *last = pool[EXCITE_BLOCKS-1];	// block handed out last (the seeded one until the first take)
+volatile uint32_t excite_repeats = 0;		// plucks that found no fresh block
+
+/*
+ * Start filling the pool in the background
+ */
+void excite_init(void)
+{
+	NVIC_InitTypeDef NVIC_InitStructure;
+	uint32_t state = SEED;
+	uint32_t n;
+
+	// the interrupt fills blocks from 0 and leaves tail-1 (the last block) alone until the first take
+	for(n = 0; n < BLOCK_WORDS; n++)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		pool[EXCITE_BLOCKS-1][2*n] = (int16_t)state;
+		pool[EXCITE_BLOCKS-1][2*n+1] = (int16_t)(state >> 16);
+	}
+
+	RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_RNG, ENABLE);
+
+	// lowest priority: refilling can always wait for audio and the strings
+	NVIC_InitStructure.NVIC_IRQChannel = HASH_RNG_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 15;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+
+	RNG_ITConfig(ENABLE);
+	RNG_Cmd(ENABLE);
+}
+
+/*
+ * Noise burst for the next pluck. It stays untouched until the following call.
+ */
+const int16_t *excite_take(void)
+{
+	uint32_t t = tail;
+
+	if(__atomic_load_n(&head, __ATOMIC_ACQUIRE) == t)
+	{
+		excite_repeats++;
+		return last;
+	}
+
+	last = pool[t % EXCITE_BLOCKS];
+	__atomic_store_n(&tail, t+1, __ATOMIC_RELEASE);
+
+	// there is room again
+	RNG_ITConfig(ENABLE);
+	return last;
+}
+
+void HASH_RNG_IRQHandler(void)
+{
+	uint32_t random;
+	int16_t *block;
+
+	// seed or clock error: restart the generator and drop the word
+	if(RNG_GetITStatus(RNG_IT_SEI) != RESET || RNG_GetITStatus(RNG_IT_CEI) != RESET)
+	{
+		RNG_ClearITPendingBit(RNG_IT_SEI | RNG_IT_CEI);
+		RNG_Cmd(DISABLE);
+		RNG_Cmd(ENABLE);
+		return;
+	}
+
+	if(RNG_GetFlagStatus(RNG_FLAG_DRDY) == RESET)
+		return;
+
+	// the block handed out last (tail-1) is never refilled, so the pool holds EXCITE_BLOCKS-1 ready blocks
+	if(head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) >= EXCITE_BLOCKS-1)
+	{
+		RNG_ITConfig(DISABLE);
+
+		// a block taken since the check would find the interrupt off
+		if(head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) < EXCITE_BLOCKS-1)
+			RNG_ITConfig(ENABLE);
+		return;
+	}
+
+	random = RNG_GetRandomNumber();
+	block = pool[head % EXCITE_BLOCKS];
+	block[2*fillWord] = (int16_t)random;				// full scale Q15 noise
+	block[2*fillWord+1] = (int16_t)(random >> 16);
+
+	fillWord++;
+	if(fillWord == BLOCK_WORDS)
+	{
+		fillWord = 0;
+		__atomic_store_n(&head, head+1, __ATOMIC_RELEASE);
+	}
+}
@@ -0,0 +1,22 @@
+//*************************************
+//
+//  header for the pluck excitation pool
+//
+//*************************************
+
+#include <stdint.h>
+#include "synth.h"
+
+#ifndef __EXCITE_H
+#define __EXCITE_H
+
+#define EXCITE_BLOCKS		4		// noise bursts in the pool (one is always being handed out)
+
+extern volatile uint32_t excite_repeats;
+
+//function prototypes
+void excite_init(void);
+const int16_t *excite_take(void);
+
+
+#endif /* __EXCITE_H */
@@ -0,0 +1,96 @@
+//*************************************
+//
+//  Karplus-Strong block kernel
+//
+//	dst[i] = ks_sample(src[i], src[i+1]) for i = 0..count-1,
+//	so src[count] must be readable. dst may be the same as src
+//	(each pair is read before it is written).
+//
+//	On the Cortex-M4 the DSP extension computes two outputs at a
+//	time: SMUAD multiplies both halfwords of a packed pair by the
+//	gain and adds them, giving (a+b)*decay in one instruction.
+//	Other targets (host builds) use the portable scalar loop,
+//	which produces bit-identical results.
+//	The packed kernel can be run from SRAM (RAMFUNC, see memory.h).
+//
+//*************************************
+
+#include "ks_kernel.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+#include "stm32f4xx.h"
+#endif
+
+/*
+ * Portable reference kernel, one sample per iteration
+ */
+void ks_kernel_block_scalar(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay)
+{
+	uint16_t i;
+
+	for(i = 0; i < count; i++)
+	{
+		dst[i] = ks_sample(src[i], src[i+1], decay);
+	}
+}
+
+#if defined(__ARM_FEATURE_DSP)
+
+/*
+ * Packed halfword kernel, two samples per iteration
+ */
+static inline __attribute__((always_inline)) void kernel_packed(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay)
+{
+	uint32_t gains = ((uint32_t)(uint16_t)decay << 16) | (uint16_t)decay;
+	uint32_t ab, bc, out;
+	int32_t lo, hi;
+
+	while(count >= 2)
+	{
+		// unaligned word loads (single LDR on the M4): [src0,src1] and [src1,src2]
+		memcpy(&ab, &src[0], 4);
+		memcpy(&bc, &src[1], 4);
+
+		lo = ((int32_t)__SMUAD(ab, gains) + 0x8000) >> 16;
+		hi = ((int32_t)__SMUAD(bc, gains) + 0x8000) >> 16;
+		out = __PKHBT(lo, hi, 16);
+
+		memcpy(&dst[0], &out, 4);
+
+		src += 2;
+		dst += 2;
+		count -= 2;
+	}
+
+	if(count != 0)
+	{
+		dst[0] = ks_sample(src[0], src[1], decay);
+	}
+}
+
+RAMFUNC void ks_kernel_block(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay)
+{
+	kernel_packed(dst, src, count, decay);
+}
+
+#ifdef SYNTH_BENCHMARK
+void ks_kernel_block_flash(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay)
+{
+	kernel_packed(dst, src, count, decay);
+}
+
+RAMFUNC_ALWAYS void ks_kernel_block_sram(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay)
+{
+	kernel_packed(dst, src, count, decay);
+}
+#endif /* SYNTH_BENCHMARK */
+
+#else
+
+void ks_kernel_block(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay)
+{
+	ks_kernel_block_scalar(dst, src, count, decay);
+}
+
+#endif /* __ARM_FEATURE_DSP */
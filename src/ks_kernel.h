@@ -0,0 +1,33 @@
+//*************************************
+//
+//  header for Karplus-Strong block kernel
+//
+//*************************************
+
+#include <stdint.h>
+#include "memory.h"
+
+#ifndef __KS_KERNEL_H
+#define __KS_KERNEL_H
+
+/*
+ * One string sample: average of two adjacent samples times the Q15 loop gain,
+ * ((a+b)/2 * decay) rounded to nearest
+ */
+static inline int16_t ks_sample(int32_t a, int32_t b, int16_t decay)
+{
+	return (int16_t)(((a+b)*decay + 0x8000) >> 16);
+}
+
+//function prototypes
+RAMFUNC void ks_kernel_block(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay);
+void ks_kernel_block_scalar(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay);
+
+#if defined(SYNTH_BENCHMARK) && defined(__ARM_FEATURE_DSP)
+// ks_kernel_block pinned to flash and to SRAM, whatever RAMFUNC_ENABLE says (see bench.c)
+void ks_kernel_block_flash(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay);
+RAMFUNC_ALWAYS void ks_kernel_block_sram(int16_t dst[], const int16_t src[], uint16_t count, int16_t decay);
+#endif
+
+
+#endif /* __KS_KERNEL_H */
@@ -0,0 +1,38 @@
+//*************************************
+//
+//  header for memory placement
+//
+//*************************************
+
+#ifndef __MEMORY_H
+#define __MEMORY_H
+
+// Zero-initialised data in the 64KB core coupled RAM (.ccmbss, cleared by the startup code).
+// Only the core's D-bus reaches CCM: no wait states and no bus matrix contention with the
+// DMA streams, but DMA can't read or write it, so DMA buffers stay in SRAM.
+#define CCM_BSS		__attribute__((section(".ccmbss")))
+
+// Hot DSP code that can be copied to SRAM along with .data by the startup code. SRAM code is fetched
+// over the S-bus with no wait states, but shares SRAM with the DMA streams; flash code has 5 wait states
+// at 168MHz, hidden by the ART accelerator as long as the loop stays in its cache. It stays in flash
+// until the SYNTH_BENCHMARK build (bench_kernel_flash/bench_kernel_sram) shows SRAM is faster while
+// DMA is running; build with -DRAMFUNC_ENABLE=1 to move it. CCM is data only (D-bus), so code can't run
+// from there. Put it on the prototype as well: long_call lets flash code call it 0x18000000 bytes away.
+#ifndef RAMFUNC_ENABLE
+#define RAMFUNC_ENABLE		0
+#endif
+
+#if defined(__arm__)
+#define RAMFUNC_ALWAYS	__attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define RAMFUNC_ALWAYS						// host builds
+#endif
+
+#if RAMFUNC_ENABLE
+#define RAMFUNC			RAMFUNC_ALWAYS
+#else
+#define RAMFUNC
+#endif
+
+
+#endif /* __MEMORY_H */
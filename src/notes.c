@@ -0,0 +1,82 @@
+//*************************************
+//
+//  guitar note table
+//
+//	Delay line length, allpass coefficient and loop gain for
+//	every string and fret, worked out by the compiler (KS_TUNING
+//	in synth.h) and kept in flash. A tuning is just the six open
+//	string frequencies; the frets are equal tempered semitones
+//	above them. To add a tuning, list its open strings below and
+//	add a row to note_table.
+//
+//	Standard tuning:
+//				Open	Fret1	Fret2	Fret3	Fret4
+//	String 6:	E2		F2		F#2		G2		G#2
+//	String 5:	A2		Bb2		B2		C3		C#3
+//	String 4:	D3		Eb3		E3		F3		F#3
+//	String 3:	G3		G#3		A3		Bb3		B3
+//	String 2:	B3		C4		C#4		D4		Eb4
+//	String 1:	E4		F4		F#4		G4		G#4
+//
+//*************************************
+
+#include "notes.h"
+
+// open string frequencies (Hz)
+#define NOTE_D2		73.4162
+#define NOTE_E2		82.4069
+#define NOTE_G2		97.9989
+#define NOTE_A2		110.0000
+#define NOTE_D3		146.8324
+#define NOTE_G3		195.9977
+#define NOTE_B3		246.9417
+#define NOTE_D4		293.6648
+#define NOTE_E4		329.6276
+
+// open strings from string 1 (high) to string 6 (low)
+#define STRINGS_STANDARD	NOTE_E4, NOTE_B3, NOTE_G3, NOTE_D3, NOTE_A2, NOTE_E2
+#define STRINGS_DROP_D		NOTE_E4, NOTE_B3, NOTE_G3, NOTE_D3, NOTE_A2, NOTE_D2
+#define STRINGS_OPEN_G		NOTE_D4, NOTE_B3, NOTE_G3, NOTE_D3, NOTE_G2, NOTE_D2
+
+// equal tempered fret ratios 2^(n/12)
+#define FRET_RATIO_0		1.0
+#define FRET_RATIO_1		1.0594630943592953
+#define FRET_RATIO_2		1.1224620483093730
+#define FRET_RATIO_3		1.1892071150027210
+#define FRET_RATIO_4		1.2599210498948732
+
+#define STRING_NOTES(f)		{ KS_TUNING((f)*FRET_RATIO_0), KS_TUNING((f)*FRET_RATIO_1), KS_TUNING((f)*FRET_RATIO_2), \
+							  KS_TUNING((f)*FRET_RATIO_3), KS_TUNING((f)*FRET_RATIO_4) }
+#define TUNING_NOTES_(s1, s2, s3, s4, s5, s6) \
+							{ STRING_NOTES(s1), STRING_NOTES(s2), STRING_NOTES(s3), \
+							  STRING_NOTES(s4), STRING_NOTES(s5), STRING_NOTES(s6) }
+#define TUNING_NOTES(strings)	TUNING_NOTES_(strings)
+
+const ks_tuning note_table[NOTE_TUNINGS][NOTE_STRINGS][NOTE_FRETS] =
+{
+	TUNING_NOTES(STRINGS_STANDARD),		// TUNING_STANDARD
+	TUNING_NOTES(STRINGS_DROP_D),		// TUNING_DROP_D
+	TUNING_NOTES(STRINGS_OPEN_G),		// TUNING_OPEN_G
+};
+
+// fret button voltage ladder: above threshold n means fret n+1 is held
+static const uint16_t fretThreshold[NOTE_FRETS-1] = {32000, 35000, 39000, 42000};
+#define FRET_RELEASED		60000	// above this no button is held
+
+/*
+ * Fret held on a string (0 = open) from its fret button ADC reading
+ */
+uint8_t notes_fret(uint16_t adcValue)
+{
+	uint8_t fret = 0;
+
+	if(adcValue > FRET_RELEASED)
+		return 0;
+
+	while(fret < NOTE_FRETS-1 && adcValue > fretThreshold[fret])
+	{
+		fret++;
+	}
+
+	return fret;
+}
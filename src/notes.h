@@ -0,0 +1,36 @@
+//*************************************
+//
+//  header for guitar note table
+//
+//*************************************
+
+#include <stdint.h>
+#include "synth.h"
+
+#ifndef __NOTES_H
+#define __NOTES_H
+
+#define NOTE_STRINGS		6		// laser strings, string 1 = high E
+#define NOTE_FRETS			5		// open string + 4 fret buttons
+
+// tunings available in note_table
+#define TUNING_STANDARD		0
+#define TUNING_DROP_D		1
+#define TUNING_OPEN_G		2
+#define NOTE_TUNINGS		3
+
+extern const ks_tuning note_table[NOTE_TUNINGS][NOTE_STRINGS][NOTE_FRETS];
+
+//function prototypes
+uint8_t notes_fret(uint16_t adcValue);
+
+/*
+ * Tuning of a string (1..6) held at a fret (0 = open)
+ */
+static inline const ks_tuning *notes_lookup(uint8_t tuning, uint8_t stringNo, uint8_t fret)
+{
+	return &note_table[tuning][stringNo-1][fret];
+}
+
+
+#endif /* __NOTES_H */
@@ -0,0 +1,137 @@
+//*************************************
+//
+//  cycle count profiling
+//
+//	Sections are timed with the DWT cycle counter (one count per
+//	168MHz core clock) and accumulated into profile_table, which
+//	can be read with the debugger at any time or printed over
+//	SWV/ITM stimulus port 0 with profile_dump().
+//	A probe costs two CYCCNT reads and a few compares; with
+//	PROFILE_ENABLE set to 0 the probes are compiled out and only
+//	the (empty) table remains.
+//	The stack (all RAM from the end of .bss to _estack) is painted
+//	at boot; the deepest word overwritten since gives its high
+//	water mark, printed by profile_dump() against _Min_Stack_Size.
+//
+//*************************************
+
+#include <stdio.h>
+#include "profile.h"
+
+profile_section profile_table[PROFILE_SECTIONS] =
+{
+	[PROFILE_BEAM_IRQ]		= { "beam_IRQ" },
+	[PROFILE_CONTROLS_IRQ]	= { "controls_IRQ" },
+	[PROFILE_RENDER]		= { "render" },
+};
+volatile uint32_t profile_boot_us = 0;		// main() entry to the first audio frame (set by main)
+
+#define STACK_PAINT		0xA5A5A5A5
+#define STACK_MARGIN	16				// words just below the stack pointer left unpainted, as slack (the live frames are all above it)
+
+// from the linker script
+extern uint32_t _end;					// end of .bss: bottom of the stack area
+extern uint32_t _estack;				// top of the stack
+extern uint32_t _Min_Stack_Size;		// budget (the symbol's address is the value)
+
+/*
+ * Start the cycle counter from 0 and clear the table (first thing in main, so boot is timed from there)
+ */
+void profile_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	profile_reset();
+}
+
+/*
+ * Clear all sections (e.g. after boot, so start-up doesn't count towards the worst case)
+ */
+void profile_reset(void)
+{
+	uint8_t i;
+
+	for(i = 0; i < PROFILE_SECTIONS; i++)
+	{
+		__disable_irq();
+		profile_table[i].count = 0;
+		profile_table[i].min = 0xFFFFFFFF;
+		profile_table[i].max = 0;
+		profile_table[i].total = 0;
+		__enable_irq();
+	}
+}
+
+/*
+ * Print min/max/mean cycles of every section that has run
+ */
+void profile_dump(void)
+{
+	profile_section snapshot;
+	uint8_t i;
+
+	printf("boot_us\t%u\n", (unsigned int)profile_boot_us);
+	printf("stack_used\t%u\tbudget\t%u\n", (unsigned int)profile_stack_used(), (unsigned int)&_Min_Stack_Size);
+
+	// tiny_printf has no field widths, so columns are tab separated
+	printf("section\tcount\tmin\tmax\tmean\n");
+	for(i = 0; i < PROFILE_SECTIONS; i++)
+	{
+		// copy with interrupts off so an ISR can't update the section half way through
+		__disable_irq();
+		snapshot = profile_table[i];
+		__enable_irq();
+
+		if(snapshot.count == 0)
+			continue;
+
+		printf("%s\t%u\t%u\t%u\t%u\n", snapshot.name, (unsigned int)snapshot.count,
+				(unsigned int)snapshot.min, (unsigned int)snapshot.max,
+				(unsigned int)(snapshot.total/snapshot.count));
+	}
+}
+
+/*
+ * Fill the unused stack with STACK_PAINT (first thing in main, before any interrupt is enabled)
+ */
+void profile_stack_paint(void)
+{
+	uint32_t *word = &_end;
+	uint32_t *top = (uint32_t *)__get_MSP() - STACK_MARGIN;
+
+	while(word < top)
+	{
+		*word++ = STACK_PAINT;
+	}
+}
+
+/*
+ * Deepest the stack has been since profile_stack_paint, in bytes
+ */
+uint32_t profile_stack_used(void)
+{
+	uint32_t *word = &_end;
+
+	while(word < &_estack && *word == STACK_PAINT)
+	{
+		word++;
+	}
+	return (uint32_t)((uint8_t *)&_estack - (uint8_t *)word);
+}
+
+/*
+ * printf() output goes to ITM stimulus port 0 (SWV console); dropped when no debugger has enabled it
+ */
+int _write(int fd, char *str, int len)
+{
+	int n;
+
+	(void)fd;
+	for(n = 0; n < len; n++)
+	{
+		ITM_SendChar(str[n]);
+	}
+	return len;
+}
@@ -0,0 +1,72 @@
+//*************************************
+//
+//  header for cycle count profiling
+//
+//*************************************
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+// build with -DPROFILE_ENABLE=0 to compile every probe out
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE		1
+#endif
+
+// profiled sections (add new ones before PROFILE_SECTIONS and name them in profile.c)
+typedef enum
+{
+	PROFILE_BEAM_IRQ = 0,		// beam detection (scan buffer) ISR
+	PROFILE_CONTROLS_IRQ,		// fret/volume scan buffer ISR
+	PROFILE_RENDER,				// schedule_render() for one block
+	PROFILE_SECTIONS
+} profile_id;
+
+typedef struct
+{
+	const char *name;
+	uint32_t count;				// times the section ran
+	uint32_t min;				// cycles
+	uint32_t max;				// cycles
+	uint64_t total;				// cycles, for the mean (total/count)
+} profile_section;
+
+extern profile_section profile_table[PROFILE_SECTIONS];
+extern volatile uint32_t profile_boot_us;
+
+// Bracket a section with PROFILE_BEGIN(id) ... PROFILE_END(id) in the same scope.
+// Each section must only be timed from one context (one ISR, or the main loop).
+#if PROFILE_ENABLE
+#define PROFILE_BEGIN(id)	uint32_t profileStart_##id = DWT->CYCCNT
+#define PROFILE_END(id)		profile_record((id), DWT->CYCCNT - profileStart_##id)
+#else
+#define PROFILE_BEGIN(id)
+#define PROFILE_END(id)
+#endif
+
+//function prototypes
+void profile_init(void);
+void profile_reset(void);
+void profile_dump(void);
+void profile_stack_paint(void);
+uint32_t profile_stack_used(void);
+
+/*
+ * Add one measurement to a section (called by PROFILE_END)
+ */
+static inline void profile_record(profile_id id, uint32_t cycles)
+{
+	profile_section *section = &profile_table[id];
+
+	if(cycles < section->min)
+		section->min = cycles;
+	if(cycles > section->max)
+		section->max = cycles;
+	section->total += cycles;
+	section->count++;
+}
+
+
+#endif /* __PROFILE_H */
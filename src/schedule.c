@@ -0,0 +1,90 @@
+//*************************************
+//
+//  sample accurate note scheduling
+//
+//	Plucks are queued with the time the beam broke (event.c).
+//	Each output block is the window of pluck times that lies
+//	SCHEDULE_LATENCY_FRAMES before the block is heard; a note
+//	starts at the frame of its pluck inside that window, so every
+//	note is delayed by the same amount and a strum or fast picking
+//	keeps its timing instead of snapping to block boundaries.
+//	Fret changes are applied the same way, retuning the string if
+//	it is still ringing (hammer-on/pull-off).
+//	The queue is not assumed to be in time order (plucks are
+//	back-dated to when the beam broke, fret changes are stamped
+//	when they are seen): each block takes everything queued into
+//	a pending list and starts the due events earliest first,
+//	keeping the rest for later blocks, so an event for a later
+//	block never holds back one due now.
+//	The block is rendered in pieces, split at each note start.
+//
+//*************************************
+
+#include "schedule.h"
+#include "event.h"
+#include "notes.h"
+
+#define PENDING_SIZE	EVENT_QUEUE_SIZE
+
+static string_event pending[PENDING_SIZE];	// popped events not started yet, in queue order
+static uint8_t pendingCount = 0;
+
+/*
+ * Render the next SYNTH_BLOCK_FRAMES frames, which start playing at startTime (event clock),
+ * starting the queued notes at the right frames, each with a new noise burst from excitation()
+ */
+void schedule_render(int16_t outBuffer[], uint32_t startTime, schedule_excitation excitation, uint8_t tuning, uint32_t duration)
+{
+	uint32_t windowStart = startTime - (uint32_t)(SCHEDULE_LATENCY_FRAMES*SCHEDULE_CYCLES_PER_FRAME);
+	uint16_t done = 0;
+	int32_t delta, earliest, frame;
+	uint8_t n, next;
+	string_event *e;
+
+	// whatever is left in the queue waits there until the pending list has room
+	while(pendingCount < PENDING_SIZE && event_pop(&pending[pendingCount]))
+	{
+		if(pending[pendingCount].type != EVENT_RELEASE)
+			pendingCount++;
+	}
+
+	while(pendingCount > 0)
+	{
+		// earliest pending event (the first queued of equal times)
+		next = 0;
+		earliest = (int32_t)(pending[0].time - windowStart);
+		for(n = 1; n < pendingCount; n++)
+		{
+			delta = (int32_t)(pending[n].time - windowStart);
+			if(delta < earliest)
+			{
+				earliest = delta;
+				next = n;
+			}
+		}
+
+		// frame of the pluck or fret change in this block (late events start straight away)
+		frame = (earliest <= 0) ? 0 : (int32_t)(earliest/SCHEDULE_CYCLES_PER_FRAME + 0.5f);
+		if(frame >= SYNTH_BLOCK_FRAMES)
+			break;
+
+		if(frame > done)
+		{
+			synth_render(&outBuffer[2*done], (uint16_t)(frame - done));
+			done = (uint16_t)frame;
+		}
+		e = &pending[next];
+		if(e->type == EVENT_ONSET)
+			synth_pluck(e->stringNo-1, excitation(), notes_lookup(tuning, e->stringNo, e->fret),
+					e->amplitude, e->brightness, duration);
+		else
+			synth_retune(e->stringNo-1, notes_lookup(tuning, e->stringNo, e->fret));
+
+		pendingCount--;
+		for(n = next; n < pendingCount; n++)
+			pending[n] = pending[n+1];
+	}
+
+	if(done < SYNTH_BLOCK_FRAMES)
+		synth_render(&outBuffer[2*done], SYNTH_BLOCK_FRAMES - done);
+}
@@ -0,0 +1,25 @@
+//*************************************
+//
+//  header for sample accurate note scheduling
+//
+//*************************************
+
+#include <stdint.h>
+#include "synth.h"
+#include "event.h"
+
+#ifndef __SCHEDULE_H
+#define __SCHEDULE_H
+
+// Time from a pluck to its note: the event must be in the queue before the block it falls in is rendered,
+// which is one block before it is played, and beam detection reports up to 240us (12 frames) late.
+#define SCHEDULE_LATENCY_FRAMES	(2*SYNTH_BLOCK_FRAMES + 16)
+#define SCHEDULE_CYCLES_PER_FRAME	((float)EVENT_CLOCK_HZ/SYNTH_SAMPLE_RATE)
+
+typedef const int16_t *(*schedule_excitation)(void);		// noise burst for the next pluck
+
+//function prototypes
+void schedule_render(int16_t outBuffer[], uint32_t startTime, schedule_excitation excitation, uint8_t tuning, uint32_t duration);
+
+
+#endif /* __SCHEDULE_H */
@@ -100,6 +100,33 @@ LoopFillZerobss:
   cmp  r2, r3
   bcc  FillZerobss
 
+/* Copy the CCM-RAM data initializers from flash */
+  ldr  r0, =_sccmram
+  ldr  r1, =_siccmram
+  ldr  r2, =_eccmram
+  b  LoopCopyCcmram
+
+CopyCcmram:
+  ldr  r3, [r1], #4
+  str  r3, [r0], #4
+
+LoopCopyCcmram:
+  cmp  r0, r2
+  bcc  CopyCcmram
+
+/* Zero fill the CCM-RAM bss (CCM_BSS in memory.h) */
+  ldr  r2, =_sccmbss
+  ldr  r1, =_eccmbss
+  movs  r3, #0
+  b  LoopFillZeroCcmbss
+
+FillZeroCcmbss:
+  str  r3, [r2], #4
+
+LoopFillZeroCcmbss:
+  cmp  r2, r1
+  bcc  FillZeroCcmbss
+
 /* Call the clock system intitialization function.*/
   bl  SystemInit   
 /* Call static constructors */
@@ -0,0 +1,328 @@
+//*************************************
+//
+//  Karplus-Strong synthesis
+//
+//	The strings are rendered on demand, one block at a time,
+//	so a pluck is heard after at most one block instead of
+//	after the whole note has been pre-rendered.
+//	Each laser string has its own voice and all of them are
+//	mixed into the same block, so chords can ring together.
+//	Each string is a single circular delay line of signed Q15
+//	samples: the sample written now is the rounded average of
+//	the two samples written one period ago times the loop gain,
+//	so every sample costs the same (no per-period buffer copy).
+//	The averaging and decay are done by the block kernel (see
+//	ks_kernel.c). The mixer and the kernel can be run from SRAM
+//	(RAMFUNC, see memory.h).
+//	The averaging delays the loop by length-0.5 samples; a first
+//	order allpass after it adds the remaining fraction of a sample
+//	so the period is exactly SYNTH_SAMPLE_RATE/frequency (see
+//	KS_TUNING in synth.h).
+//	A ringing string can be retuned (fret change): for the next
+//	SYNTH_FADE_FRAMES samples the loop feeds back a linear
+//	crossfade from the old read position to the new one, so the
+//	pitch slides over without a click or a new noise burst.
+//	A longer period can reach back past the samples written since
+//	the pluck; the gap is filled by repeating the current period.
+//	A retune during a crossfade waits for it to finish, so the
+//	fade always starts from a steady read position.
+//
+//*************************************
+
+#include "synth.h"
+#include "ks_kernel.h"
+#include "memory.h"
+
+#define LINE_MASK			(SYNTH_LINE_SIZE-1)
+
+// electric mode clipping level (was 105 -> 180 on the unsigned 8-bit waveform)
+#define ELECTRIC_THRESHOLD	(-5888)
+#define ELECTRIC_LEVEL		13312
+
+typedef struct
+{
+	int16_t line[SYNTH_LINE_SIZE];			// circular delay line holding the last period of the string
+	uint16_t length;						// delay line length in samples; determines note frequency and octave
+	uint16_t write;							// next position to write (the read position is length behind)
+	int16_t coef;							// allpass coefficient (Q15); fine tunes the period
+	int16_t decay;							// loop gain (Q15)
+	int16_t apIn;							// allpass state: previous input
+	int16_t apOut;							// allpass state: previous output
+	uint16_t fadeLength;					// delay line length being faded out after a retune
+	uint16_t fade;							// crossfade samples left (0 = not fading)
+	uint16_t history;						// samples behind write that belong to this note (up to SYNTH_LINE_SIZE)
+	ks_tuning retune;						// retune waiting for the crossfade to finish (length 0 = none)
+	uint32_t remaining;						// samples left before the note is cut off (0 = silent)
+	int32_t gain;							// output gain (Q15)
+} ks_voice;
+
+// the delay lines and the mix are only touched by the core, so they live in CCM, away from the DMA traffic
+static ks_voice ccmVoices[SYNTH_VOICES] CCM_BSS;
+static int32_t ccmMix[SYNTH_BLOCK_FRAMES] CCM_BSS;
+
+#ifdef SYNTH_BENCHMARK
+// SRAM copies, so bench.c can time the same render with and without CCM (synth_bench_sram)
+static ks_voice sramVoices[SYNTH_VOICES];
+static int32_t sramMix[SYNTH_BLOCK_FRAMES];
+static ks_voice *voices = ccmVoices;
+static int32_t *mixBuffer = ccmMix;
+#else
+static ks_voice * const voices = ccmVoices;
+static int32_t * const mixBuffer = ccmMix;
+#endif
+static uint8_t electric = 0;
+
+RAMFUNC static void voice_render(ks_voice *voice, uint16_t frames);
+RAMFUNC static void retune_start(ks_voice *voice, const ks_tuning *tuning);
+
+/*
+ * Re-excite a string with a noise burst and (re)start its note.
+ * The burst goes through a one-pole lowpass (brightness, see SYNTH_BRIGHTNESS) on the way in,
+ * so the tone of the pluck costs nothing per sample afterwards.
+ * The other strings keep ringing.
+ */
+void synth_pluck(uint8_t voiceNo, const int16_t excitation[], const ks_tuning *tuning, float amplitude, uint16_t brightness, uint32_t duration)
+{
+	ks_voice *voice;
+	uint16_t delayLength = tuning->length;
+	uint16_t n;
+	int32_t filtered = 0;
+
+	if(voiceNo >= SYNTH_VOICES)
+		return;
+	voice = &voices[voiceNo];
+
+	if(delayLength > SYNTH_MAX_DELAY)
+		delayLength = SYNTH_MAX_DELAY;
+
+	// the (filtered) noise burst becomes the previous period of the string
+	for(n = 0; n < delayLength; n++)
+	{
+		filtered += (brightness*(excitation[n] - filtered)) >> 15;
+		voice->line[(voice->write - delayLength + n) & LINE_MASK] = (int16_t)filtered;
+	}
+
+	voice->length = delayLength;
+	voice->coef = tuning->coef;
+	voice->decay = tuning->decay;
+	voice->apIn = 0;
+	voice->apOut = 0;
+	voice->fade = 0;
+	voice->history = delayLength;
+	voice->retune.length = 0;
+	voice->gain = (int32_t)(amplitude*SYNTH_LEVEL);
+	voice->remaining = duration;
+}
+
+/*
+ * Move a ringing string to a new note (hammer-on/pull-off) without re-exciting it
+ */
+void synth_retune(uint8_t voiceNo, const ks_tuning *tuning)
+{
+	ks_voice *voice;
+
+	if(voiceNo >= SYNTH_VOICES)
+		return;
+	voice = &voices[voiceNo];
+
+	if(voice->remaining == 0)
+		return;
+
+	// one crossfade at a time; if several retunes wait, the latest wins
+	if(voice->fade != 0)
+	{
+		voice->retune = *tuning;
+		return;
+	}
+	retune_start(voice, tuning);
+}
+
+/*
+ * Set/reset electric mode (clips waveform)
+ */
+void synth_set_electric(uint8_t enable)
+{
+	electric = enable;
+}
+
+#ifdef SYNTH_BENCHMARK
+/*
+ * Move the voices and the mix to SRAM (1) or back to CCM (0). The notes don't move with them,
+ * so only call this with the interrupts off and pluck again afterwards.
+ */
+void synth_bench_sram(uint8_t enable)
+{
+	voices = enable ? sramVoices : ccmVoices;
+	mixBuffer = enable ? sramMix : ccmMix;
+}
+#endif /* SYNTH_BENCHMARK */
+
+/*
+ * Render the next block (at most SYNTH_BLOCK_FRAMES frames) of interleaved L/R samples for the audio DAC
+ */
+RAMFUNC void synth_render(int16_t outBuffer[], uint16_t frames)
+{
+	uint16_t i;
+	uint8_t v;
+	int32_t sample;
+
+	if(frames > SYNTH_BLOCK_FRAMES)
+		frames = SYNTH_BLOCK_FRAMES;
+
+	for(i = 0; i < frames; i++)
+	{
+		mixBuffer[i] = 0;
+	}
+
+	// silent strings cost nothing, so a block never costs more than all six ringing
+	for(v = 0; v < SYNTH_VOICES; v++)
+	{
+		if(voices[v].remaining > 0)
+		{
+			voice_render(&voices[v], frames);
+		}
+	}
+
+	for(i = 0; i < frames; i++)
+	{
+		sample = mixBuffer[i];
+		if(sample > 32767)
+			sample = 32767;
+		else if(sample < -32768)
+			sample = -32768;
+
+		// same sample value on L & R channels
+		outBuffer[2*i] = (int16_t)sample;
+		outBuffer[2*i+1] = (int16_t)sample;
+	}
+}
+
+/*
+ * Start the crossfade from the current delay length to a new one
+ */
+RAMFUNC static void retune_start(ks_voice *voice, const ks_tuning *tuning)
+{
+	uint16_t delayLength = tuning->length;
+	uint16_t n;
+
+	if(delayLength > SYNTH_MAX_DELAY)
+		delayLength = SYNTH_MAX_DELAY;
+
+	// the new read position must not see what the previous note left in the line:
+	// extend this note's history backwards by repeating the current period
+	for(n = voice->history; n < delayLength; n++)
+	{
+		voice->line[(voice->write - 1 - n) & LINE_MASK] = voice->line[(voice->write - 1 - n + voice->length) & LINE_MASK];
+	}
+	if(voice->history < delayLength)
+		voice->history = delayLength;
+
+	// fade from where the loop is reading now
+	voice->fadeLength = voice->length;
+	voice->fade = SYNTH_FADE_FRAMES;
+
+	voice->length = delayLength;
+	voice->coef = tuning->coef;
+	voice->decay = tuning->decay;
+	voice->retune.length = 0;
+}
+
+/*
+ * Add the next frames of a ringing string to mixBuffer
+ */
+RAMFUNC static void voice_render(ks_voice *voice, uint16_t frames)
+{
+	uint16_t i = 0;
+	uint16_t w = voice->write;
+	uint16_t r, k, run, rOld;
+	int32_t value, apIn, apOut, faded, weight;
+
+	while(i < frames && voice->remaining > 0)
+	{
+		if(voice->fade == 0 && voice->retune.length != 0)
+		{
+			voice->write = w;
+			retune_start(voice, &voice->retune);
+		}
+		r = (w - voice->length) & LINE_MASK;
+
+		run = frames - i;
+		if(run > voice->remaining)
+			run = voice->remaining;
+
+		if(voice->fade != 0)
+		{
+			// retune crossfade, one sample at a time: old read position weighted fade/SYNTH_FADE_FRAMES
+			if(run > voice->fade)
+				run = voice->fade;
+			if(run > SYNTH_LINE_SIZE - w)
+				run = SYNTH_LINE_SIZE - w;
+
+			for(k = 0; k < run; k++)
+			{
+				r = (w + k - voice->length) & LINE_MASK;
+				rOld = (w + k - voice->fadeLength) & LINE_MASK;
+				value = ks_sample(voice->line[r], voice->line[(r+1) & LINE_MASK], voice->decay);
+				faded = ks_sample(voice->line[rOld], voice->line[(rOld+1) & LINE_MASK], voice->decay);
+				weight = (voice->fade - k) * (32768/SYNTH_FADE_FRAMES);
+				voice->line[w+k] = (int16_t)(value + (((faded - value)*weight) >> 15));
+			}
+			voice->fade -= run;
+		}
+		else
+		{
+			// karplus-strong algorithm, in runs where neither the read nor the write
+			// position wraps and the samples being written are not read back yet
+			if(run > LINE_MASK - r)
+				run = LINE_MASK - r;
+			if(run > SYNTH_LINE_SIZE - w)
+				run = SYNTH_LINE_SIZE - w;
+			if(run > voice->length-1)
+				run = voice->length-1;
+
+			if(run != 0)
+			{
+				ks_kernel_block(&voice->line[w], &voice->line[r], run, voice->decay);
+			}
+			else
+			{
+				// read position is at the end of the line, its neighbour is at the start
+				voice->line[w] = ks_sample(voice->line[r], voice->line[0], voice->decay);
+				run = 1;
+			}
+		}
+
+		// fractional delay: y = coef*(x - y[n-1]) + x[n-1], written back into the line
+		apIn = voice->apIn;
+		apOut = voice->apOut;
+		for(k = 0; k < run; k++)
+		{
+			value = voice->line[w+k];
+			apOut = ((voice->coef*(value - apOut) + 0x4000) >> 15) + apIn;
+			apIn = value;
+			if(apOut > 32767)
+				apOut = 32767;
+			else if(apOut < -32768)
+				apOut = -32768;
+			voice->line[w+k] = (int16_t)apOut;
+			value = apOut;
+
+			// electric mode (clips waveform)
+			if(electric == 1 && value < ELECTRIC_THRESHOLD)
+			{
+				value = ELECTRIC_LEVEL;
+			}
+
+			mixBuffer[i+k] += (value*voice->gain) >> 15;
+		}
+		voice->apIn = (int16_t)apIn;
+		voice->apOut = (int16_t)apOut;
+
+		i += run;
+		w = (w + run) & LINE_MASK;
+		voice->remaining -= run;
+		voice->history = (voice->history > SYNTH_LINE_SIZE - run) ? SYNTH_LINE_SIZE : voice->history + run;
+	}
+
+	voice->write = w;
+}
@@ -0,0 +1,56 @@
+//*************************************
+//
+//  header for Karplus-Strong synthesis
+//
+//*************************************
+
+#include <stdint.h>
+#include "memory.h"
+
+#ifndef __SYNTH_H
+#define __SYNTH_H
+
+#define SYNTH_SAMPLE_RATE	47991.07f	// actual I2S frame rate: PLLI2S 86MHz/(256*7) for a 48kHz request (see codec.c)
+#define SYNTH_BLOCK_FRAMES	64		// stereo frames rendered per block (1.3ms at 48kHz)
+#define SYNTH_MAX_DELAY		700		// longest string delay line (D2 = 654 samples)
+#define SYNTH_LINE_SIZE		1024	// circular delay line length (power of 2, > SYNTH_MAX_DELAY)
+#define SYNTH_VOICES		6		// one voice per laser string
+
+#define SYNTH_DECAY			32735	// Q15 loop gain (0.999)
+#define SYNTH_LEVEL			5461	// Q15 output level of a full scale string at amplitude 1.0 (1/6: six strings can't clip;
+									// the volume knob is the codec master volume, see codec_set_volume)
+#define SYNTH_FADE_FRAMES	64		// crossfade between the old and new delay length when a ringing string is retuned
+
+// Excitation lowpass coefficient (Q15, 32768 = unfiltered) for a pluck velocity in [0, 1]: soft plucks are darker
+#define SYNTH_DARKEST		3277	// 0.1
+#define SYNTH_BRIGHTNESS(velocity)	((uint16_t)(SYNTH_DARKEST + (velocity)*(32768 - SYNTH_DARKEST)))
+
+// string tuning: integer delay line length plus a first order allpass for the fractional part
+typedef struct
+{
+	uint16_t length;		// delay line length in samples
+	int16_t coef;			// allpass coefficient (Q15)
+	int16_t decay;			// loop gain (Q15)
+} ks_tuning;
+
+// Tuning for a note frequency f (Hz) as a constant expression, so tables are built by the compiler.
+// The averaging delays the loop by length-0.5 samples and the allpass adds d in [0.1, 1.1)
+// (where its phase delay is flat), so length-0.5+d = SYNTH_SAMPLE_RATE/f.
+#define KS_DELAY(f)			((double)SYNTH_SAMPLE_RATE/(f) + 0.5)
+#define KS_LENGTH(f)		((uint16_t)(KS_DELAY(f) - 0.1))
+#define KS_FRACTION(f)		(KS_DELAY(f) - KS_LENGTH(f))
+#define KS_COEF(f)			((int16_t)(32768.0*(1.0-KS_FRACTION(f))/(1.0+KS_FRACTION(f))))
+#define KS_TUNING(f)		{ KS_LENGTH(f), KS_COEF(f), SYNTH_DECAY }
+
+//function prototypes
+void synth_pluck(uint8_t voiceNo, const int16_t excitation[], const ks_tuning *tuning, float amplitude, uint16_t brightness, uint32_t duration);
+void synth_retune(uint8_t voiceNo, const ks_tuning *tuning);
+void synth_set_electric(uint8_t enable);
+RAMFUNC void synth_render(int16_t outBuffer[], uint16_t frames);
+
+#ifdef SYNTH_BENCHMARK
+void synth_bench_sram(uint8_t enable);		// voices and mix in SRAM instead of CCM (see bench.c)
+#endif
+
+
+#endif /* __SYNTH_H */